@@ -0,0 +1,77 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef BRIGHTNESS_HPP
+#define BRIGHTNESS_HPP
+
+#include <cstdint>
+
+// Panel brightness in whole levels; the driver takes level / 255. It scales
+// colours before its own gamma correction, so equal steps in level look
+// like equal steps in brightness.
+constexpr int max_brightness_level = 255;
+
+inline float brightness_fraction(uint8_t level) {
+  return level / static_cast<float>(max_brightness_level);
+}
+
+// Brightness that follows the room, from the Galactic Unicorn's light
+// sensor. Readings go through a first-order IIR filter in fixed point,
+// y += (x - y) / 2^filter_shift, so a passing shadow or a lamp flickering
+// does not reach the panel. The sensor's phototransistor reads in
+// proportion to the light falling on it, and the driver applies the eye's
+// gamma to the level itself, so the filtered reading maps straight onto
+// the levels from min_level to max_level: the panel gives off light in
+// proportion to the room's, a tenth of the full reading gives level 31 and
+// half of it 130, and in the dark it is down to min_level. Changes smaller
+// than `hysteresis` levels are ignored, so noise does not make the panel
+// flicker between two levels.
+class AutoBrightness {
+public:
+  static constexpr int filter_shift = 3;      //!< time constant of 8 samples
+  static constexpr int hysteresis = 3;        //!< levels
+  static constexpr int min_level = 6;         //!< digits stay readable in the dark
+  static constexpr int max_level = max_brightness_level;
+  static constexpr int reading_bits = 12;     //!< RP2040 ADC
+  static constexpr uint32_t sample_interval_ms = 500;
+
+  // Feeds a sensor reading; returns true if level() changed.
+  bool add(uint16_t reading) {
+    if (reading > max_reading) {
+      reading = max_reading;
+    }
+    uint32_t sample = static_cast<uint32_t>(reading) << fraction_bits;
+    if (!primed) {
+      filtered = sample;  // start from the room as it is, not from dark
+      primed = true;
+    } else {
+      filtered += (static_cast<int32_t>(sample - filtered)) >> filter_shift;
+    }
+    int target = level_of(filtered);
+    int difference = target > current ? target - current : current - target;
+    bool at_end = target == min_level || target == max_level;
+    if (difference == 0 || (difference < hysteresis && !at_end)) {
+      return false;
+    }
+    current = static_cast<uint8_t>(target);
+    return true;
+  }
+
+  uint8_t level() const { return current; }
+
+private:
+  static constexpr uint16_t max_reading = (1 << reading_bits) - 1;
+  static constexpr int fraction_bits = 8;     //!< of the filtered reading
+  static constexpr uint32_t full_scale = static_cast<uint32_t>(max_reading) << fraction_bits;
+
+  // Level of a filtered reading, rounded
+  static int level_of(uint32_t filtered) {
+    uint32_t span = max_level - min_level;
+    return min_level + static_cast<int>((filtered * span + full_scale / 2) / full_scale);
+  }
+
+  uint32_t filtered = 0;
+  bool     primed = false;
+  uint8_t  current = 0;
+};
+
+#endif  // BRIGHTNESS_HPP
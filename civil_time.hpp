@@ -0,0 +1,124 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef CIVIL_TIME_HPP
+#define CIVIL_TIME_HPP
+
+#include <cstdint>
+
+// Conversions between a count of seconds or days since 1970-01-01 and the
+// proleptic Gregorian calendar, in integer arithmetic and without tables
+// (after H. Hinnant, "chrono-Compatible Low-Level Date Algorithms"). They
+// take the place of newlib's localtime(), which pulls in its timezone and
+// locale code, and work as constant expressions. The calendar is counted
+// in eras of 400 years, which repeat exactly, with the year starting in
+// March so that the leap day comes last.
+struct CivilTime {
+  int32_t year;
+  uint8_t month;    //!< 1 to 12
+  uint8_t day;      //!< 1 to 31
+  uint8_t weekday;  //!< 0 is Sunday
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+};
+
+// Quotient rounded towards minus infinity, for times before 1970
+constexpr int64_t floor_div(int64_t a, int64_t b) {
+  return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// Day of the week of the day `days` days after 1970-01-01, 0 is Sunday;
+// 1970-01-01 was a Thursday.
+constexpr unsigned weekday_from_days(int64_t days) {
+  return static_cast<unsigned>(days - floor_div(days + 4, 7) * 7 + 4);
+}
+
+// Days since 1970-01-01 of a date
+constexpr int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  int64_t era = floor_div(year, 400);
+  unsigned year_of_era = static_cast<unsigned>(year - era * 400);                 // [0, 399]
+  unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0, 365]
+  unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+// Date `days` days after 1970-01-01; only the date fields are set.
+constexpr CivilTime civil_from_days(int64_t days) {
+  days += 719468;  // days since 0000-03-01
+  int64_t era = floor_div(days, 146097);
+  unsigned day_of_era = static_cast<unsigned>(days - era * 146097);  // [0, 146096]
+  unsigned year_of_era =
+    (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+  unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  unsigned month_index = (5 * day_of_year + 2) / 153;  // [0, 11], 0 is March
+  unsigned day = day_of_year - (153 * month_index + 2) / 5 + 1;
+  unsigned month = month_index < 10 ? month_index + 3 : month_index - 9;
+  int64_t year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2);
+  return CivilTime{
+    .year = static_cast<int32_t>(year),
+    .month = static_cast<uint8_t>(month),
+    .day = static_cast<uint8_t>(day),
+    .weekday = static_cast<uint8_t>(weekday_from_days(days - 719468)),
+    .hour = 0,
+    .minute = 0,
+    .second = 0,
+  };
+}
+
+// Date and time `seconds` seconds after 1970-01-01 00:00:00, leap seconds
+// not counted, as in Unix time.
+constexpr CivilTime civil_from_seconds(int64_t seconds) {
+  int64_t days = floor_div(seconds, 86400);
+  uint32_t second_of_day = static_cast<uint32_t>(seconds - days * 86400);
+  CivilTime t = civil_from_days(days);
+  t.hour = static_cast<uint8_t>(second_of_day / 3600);
+  t.minute = static_cast<uint8_t>(second_of_day / 60 % 60);
+  t.second = static_cast<uint8_t>(second_of_day % 60);
+  return t;
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0, "epoch");
+static_assert(days_from_civil(2000, 3, 1) == 11017, "after a century's leap day");
+static_assert(days_from_civil(1969, 12, 31) == -1, "before the epoch");
+static_assert(civil_from_days(-719468).year == 0 && civil_from_days(-719468).month == 3,
+              "start of the first era");
+static_assert(civil_from_seconds(1700000000).hour == 22 &&
+              civil_from_seconds(1700000000).minute == 13 &&
+              civil_from_seconds(1700000000).weekday == 2, "2023-11-14 22:13:20, a Tuesday");
+static_assert(civil_from_seconds(-1).year == 1969 && civil_from_seconds(-1).second == 59,
+              "last second before the epoch");
+
+// The six digits of a time of day, hh:mm:ss. tick() steps them on by one
+// second by carrying from digit to digit, so a clock that shows every
+// second only converts a time in full when it jumps.
+struct TimeDigits {
+  uint8_t digits[6];  //!< tens of hours first
+
+  constexpr void set(unsigned hour, unsigned minute, unsigned second) {
+    digits[0] = static_cast<uint8_t>(hour / 10);
+    digits[1] = static_cast<uint8_t>(hour % 10);
+    digits[2] = static_cast<uint8_t>(minute / 10);
+    digits[3] = static_cast<uint8_t>(minute % 10);
+    digits[4] = static_cast<uint8_t>(second / 10);
+    digits[5] = static_cast<uint8_t>(second % 10);
+  }
+
+  constexpr void tick() {
+    constexpr uint8_t limits[6] = {0, 0, 6, 10, 6, 10};  //!< hours wrap on their own
+    for (int i = 5; i >= 2; i--) {
+      if (++digits[i] < limits[i]) {
+        return;
+      }
+      digits[i] = 0;
+    }
+    if (digits[0] == 2 && digits[1] == 3) {
+      digits[0] = digits[1] = 0;
+    } else if (++digits[1] == 10) {
+      digits[1] = 0;
+      digits[0]++;
+    }
+  }
+};
+
+#endif  // CIVIL_TIME_HPP
@@ -0,0 +1,359 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef CLOCK_APP_HPP
+#define CLOCK_APP_HPP
+
+#include <cinttypes>
+
+#include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "pico/cyw43_arch.h"
+#include "pico/util/datetime.h"
+#include "pico/stdlib.h"
+#include "clock_discipline.hpp"
+#include "flash_journal.hpp"
+#include "ntp_client.hpp"
+#include "scheduler.hpp"
+#include "second_tick.hpp"
+#include "time_zone.hpp"
+#include "time_zones.hpp"
+#include "wifi_link.hpp"
+
+// Into the second, long after the digit flip. Even the longest erase of a
+// journal sector, 400 ms, ends before the next flip.
+constexpr uint32_t journal_delay_ms = 500;
+
+// Core 0 state of a clock: the timebase and what goes with it. The display
+// policy reads it and changes settings through it.
+struct ClockCore {
+  ClockDiscipline timebase;
+  LocalTime       local_time;             //!< for the RTC and the log
+  uint8_t         time_zone = 0;          //!< index into time_zones
+  bool            rtc_reload = false;     //!< load the RTC on the next second tick
+  bool            time_restored = false;  //!< the time is shown from the journal, not status texts
+  WifiLink        wifi;
+  FlashJournal<ClockState, journal_sectors> journal;
+  ClockState      kept;                   //!< settings as found, for those the display does not have
+  bool            journal_dirty = false;  //!< the time or settings changed since the last entry
+  bool            journal_write_due = false;       //!< journal_write_worker is scheduled
+  absolute_time_t journal_allowed = nil_time;      //!< rate limit for changed settings
+
+  // Local date and time at Unix second `second`
+  datetime_t local_datetime(int64_t second) {
+    CivilTime local = local_time.civil(second);
+    return datetime_t{
+      .year = static_cast<int16_t>(local.year),
+      .month = static_cast<int8_t>(local.month),
+      .day = static_cast<int8_t>(local.day),
+      .dotw = static_cast<int8_t>(local.weekday),
+      .hour = static_cast<int8_t>(local.hour),
+      .min = static_cast<int8_t>(local.minute),
+      .sec = static_cast<int8_t>(local.second)
+    };
+  }
+
+  // Switches to time zone `zone`, for the RTC and the journal.
+  void select_time_zone(int zone) {
+    time_zone = static_cast<uint8_t>(zone);
+    local_time.set_zone(time_zones[zone]);
+    rtc_reload = true;
+    journal_dirty = true;
+  }
+};
+
+// Both clocks on core 0: Wi-Fi, NTP, the RTC, the second tick and the
+// journal, run as workers of the cyw43 arch's async context. What the
+// clocks differ in, how they show the time, is the `Display` policy, whose
+// hooks are called directly, so each image only has the code its display
+// uses and hooks that do nothing cost nothing:
+//
+//   void init(ClockCore &)      sets up the panel once the journal was read
+//   void start(ClockCore &, async_context_t *)  adds workers of its own
+//   void status(const char *)   shows a status text
+//   void timebase_updated(ClockCore &)  the timebase took an NTP sample
+//   void tick(ClockCore &, int64_t second)  from the worker of each second tick
+//   bool adjusting() const      a setting is being changed, do not write yet
+//   void restore(const ClockState &)  takes its settings from the journal
+//   void save(ClockState *)     puts its settings into a journal entry
+//   void begin_flash_write()    flash is about to stop being readable
+//   void end_flash_write()
+template <typename Display>
+class ClockApp {
+public:
+  // Runs the clock; main() of the firmware.
+  static int run() {
+    stdio_init_all();
+    int zone = time_zones.find(NTP_RTC_TIME_ZONE);
+    if (zone < 0) {
+      printf("time zone %s not compiled in, using %s\n", NTP_RTC_TIME_ZONE, time_zones[0].name);
+      zone = 0;
+    }
+    core.time_zone = static_cast<uint8_t>(zone);
+    restore_clock_state();
+    core.local_time.set_zone(time_zones[core.time_zone]);
+    display.init(core);
+    if (core.time_restored) {
+      // Show the kept time right away and let NTP correct it.
+      SecondTick::start(core.timebase);
+      core.rtc_reload = true;
+    }
+
+    printf("ntp_rtc\n");
+    rtc_init();
+    printf("RTC: initialized\n");
+
+    if (cyw43_arch_init()) {
+      printf("cyw43: failed to initialise\n");
+      return 1;
+    }
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+    printf("cyw43: initialized\n");
+
+    cyw43_arch_enable_sta_mode();
+    printf("enabled STA mode, connecting to WiFi...\n");
+    show_status("connecting");
+    core.wifi.start(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+    run_ntp_main();
+    cyw43_arch_deinit();
+    return 0;
+  }
+
+private:
+  // Status texts would only flash over the time kept in the journal.
+  static void show_status(const char *text) {
+    if (!core.time_restored) {
+      display.status(text);
+    }
+  }
+
+  // Takes the time and settings the clock starts from after power-up from
+  // the journal, if there are any.
+  static void restore_clock_state() {
+    if (!core.journal.open(&core.kept)) {
+      printf("journal: empty\n");
+      return;
+    }
+    int zone = time_zones.find(core.kept.time_zone);
+    if (zone >= 0) {
+      core.time_zone = static_cast<uint8_t>(zone);
+    }
+    display.restore(core.kept);
+    core.timebase.restore(time_us_64(), core.kept.utc_us, core.kept.frequency_ppb);
+    core.time_restored = true;
+    printf("journal: restored time, %s, %s brightness, frequency %+" PRId32 " ppb\n",
+           time_zones[core.time_zone].name, core.kept.auto_brightness ? "automatic" : "manual",
+           core.kept.frequency_ppb);
+  }
+
+  // Runs `write` on the journal's flash. Erasing and programming flash stop
+  // XIP, which the interrupt handlers run from, so they wait meanwhile, and
+  // so does anything the display runs elsewhere.
+  template <typename Write>
+  static void write_flash(Write write) {
+    display.begin_flash_write();
+    uint32_t irq_status = save_and_disable_interrupts();
+    write();
+    restore_interrupts(irq_status);
+    display.end_flash_write();
+  }
+
+  // Appends the time and settings to the journal. With the sector erased
+  // ahead, this programs a single page, which stalls for 3 ms at most.
+  static void write_journal() {
+    ClockState state = core.kept;
+    state.utc_us = core.timebase.utc_us(time_us_64());
+    state.frequency_ppb = static_cast<int32_t>(core.timebase.frequency());
+    state.time_zone = time_zone_id(time_zones[core.time_zone].name);
+    display.save(&state);
+    bool written = false;
+    write_flash([&] { written = core.journal.append(state); });
+    if (!written) {
+      printf("journal: write failed\n");
+    }
+    core.kept = state;
+  }
+
+  // Hands a sample to the timebase, then has the next poll scheduled.
+  static void ntp_result(NTP_T *state, bool ok, const NtpSample *sample) {
+    if (sample) {
+      ClockDiscipline &timebase = core.timebase;
+      uint64_t now = time_us_64();
+      // The second tick reads the timebase from its alarm interrupt.
+      uint32_t irq_status = save_and_disable_interrupts();
+      bool stepped = timebase.update(now, *sample);
+      restore_interrupts(irq_status);
+      int64_t second = timebase.utc_us(now) / 1000000;
+      datetime_t t = core.local_datetime(second);
+      printf("got NTP response: %02d/%02d/%04d %02d:%02d:%02d %s (delay %" PRId64
+             " us, %s %+" PRId64 " us, frequency %+" PRId64 " ppb, poll %" PRIu32
+             " s)\n", t.day, t.month, t.year, t.hour, t.min, t.sec,
+             core.local_time.abbreviation(second), sample->delay_us,
+             stepped ? "step" : "slew", timebase.error(), timebase.frequency(),
+             timebase.poll_interval_s());
+      if (stepped) {
+        show_status("NTP ok");
+        SecondTick::start(timebase);
+        core.journal_dirty = true;
+        reschedule(cyw43_arch_async_context(), &journal_refresh_worker,
+                   make_timeout_time_ms(journal_interval_ms));
+      }
+      core.rtc_reload = true;
+      display.timebase_updated(core);
+    }
+    ntp_end_poll(state, ok);
+  }
+
+  // Follows the Wi-Fi link. NTP polls wait for it, and once it is up again
+  // the next poll goes out right away. Status texts and the LED only tell
+  // of the link until the time is known.
+  static void poll_wifi(NTP_T *state) {
+    if (!core.wifi.poll()) {
+      return;
+    }
+    if (core.wifi.up() && !state->poll_active) {
+      reschedule(cyw43_arch_async_context(), &state->poll_worker, get_absolute_time());
+    }
+    if (!core.timebase.synchronised()) {
+      cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, !core.wifi.up());
+      show_status(core.wifi.up() ? "Getting NTP" : "connecting");
+    }
+  }
+
+  static void ntp_poll_work(async_context_t *context, async_at_time_worker_t *worker) {
+    NTP_T *state = (NTP_T *)worker->user_data;
+    // Without Wi-Fi, poll_wifi() reschedules the poll for when it is back.
+    if (core.wifi.up() && !state->poll_active) {
+      ntp_start_poll(state);
+    }
+  }
+
+  static void ntp_done_work(async_context_t *context, async_when_pending_worker_t *worker) {
+    NTP_T *state = (NTP_T *)worker->user_data;
+    if (!state->poll_active || !ntp_poll_done(state)) {
+      return;
+    }
+    NtpSample sample;
+    switch (ntp_finish_poll(state, &sample)) {
+      case NtpPoll::dns_failed:
+        show_status("DNS failed");
+        ntp_result(state, false, nullptr);
+        break;
+      case NtpPoll::request_failed:
+        show_status("NTP failed");
+        ntp_result(state, false, nullptr);
+        break;
+      case NtpPoll::no_news:
+        ntp_result(state, true, nullptr);
+        break;
+      case NtpPoll::sample:
+        ntp_result(state, true, &sample);
+        break;
+    }
+  }
+
+  static void wifi_work(async_context_t *context, async_at_time_worker_t *worker) {
+    poll_wifi((NTP_T *)worker->user_data);
+    async_context_add_at_time_worker_at(context, worker, core.wifi.next_poll());
+  }
+
+  static void second_tick_irq() {
+    async_context_set_work_pending(cyw43_arch_async_context(), &second_worker);
+  }
+
+  static void second_work(async_context_t *context, async_when_pending_worker_t *worker) {
+    if (!SecondTick::pending()) {
+      return;
+    }
+    int64_t second;
+    bool on_second = SecondTick::on_second();
+    SecondTick::take(&second);
+    if (core.rtc_reload && on_second) {
+      // Keep the RTC in step with the timebase for anything reading it.
+      datetime_t t = core.local_datetime(second);
+      rtc_set_datetime(&t);
+      core.rtc_reload = false;
+    }
+    display.tick(core, second);
+    // Changed settings are written once they have been left alone for a
+    // while, not while they are being adjusted. A journal sector the next
+    // entry needs is erased ahead, on a second of its own.
+    bool write = core.journal_dirty && time_reached(core.journal_allowed);
+    if ((write || core.journal.erase_due()) && !display.adjusting() &&
+        !core.journal_write_due) {
+      async_context_add_at_time_worker_in_ms(context, &journal_write_worker, journal_delay_ms);
+      core.journal_write_due = true;
+    }
+  }
+
+  static void journal_write_work(async_context_t *context, async_at_time_worker_t *worker) {
+    core.journal_write_due = false;
+    if (core.journal.erase_due()) {
+      write_flash([] { core.journal.prepare(); });
+      return;  // the entry follows on a later second
+    }
+    write_journal();
+    core.journal_dirty = false;
+    core.journal_allowed = make_timeout_time_ms(journal_min_interval_ms);
+  }
+
+  static void journal_refresh_work(async_context_t *context, async_at_time_worker_t *worker) {
+    core.journal_dirty = true;
+    async_context_add_at_time_worker_in_ms(context, worker, journal_interval_ms);
+  }
+
+  // Network side on core 0: sets up its work and runs forever
+  static void run_ntp_main() {
+    async_context_t *context = cyw43_arch_async_context();
+    // None of the work runs before all of it is in place.
+    async_context_acquire_lock_blocking(context);
+    NTP_T *state = ntp_init(&core.timebase, &core.wifi);
+    if (state == nullptr) {
+      async_context_release_lock(context);
+      return;
+    }
+    // Polls start once Wi-Fi is up.
+    state->poll_worker.do_work = ntp_poll_work;
+    state->poll_worker.user_data = state;
+    state->done_worker.do_work = ntp_done_work;
+    state->done_worker.user_data = state;
+    async_context_add_when_pending_worker(context, &state->done_worker);
+    wifi_worker.do_work = wifi_work;
+    wifi_worker.user_data = state;
+    async_context_add_at_time_worker_at(context, &wifi_worker, core.wifi.next_poll());
+
+    second_worker.do_work = second_work;
+    async_context_add_when_pending_worker(context, &second_worker);
+    SecondTick::on_tick(second_tick_irq);
+    async_context_set_work_pending(context, &second_worker);
+    journal_write_worker.do_work = journal_write_work;
+    journal_refresh_worker.do_work = journal_refresh_work;
+    if (core.timebase.synchronised()) {
+      async_context_add_at_time_worker_in_ms(context, &journal_refresh_worker,
+                                             journal_interval_ms);
+    }
+    display.start(core, context);
+    async_context_release_lock(context);
+
+    // Under the poll arch the work runs from cyw43_arch_poll(), and the wait
+    // lasts until the next worker is due or an interrupt has work pending.
+    // Under the threadsafe_background arch both calls leave core 0 asleep.
+    while (true) {
+      cyw43_arch_poll();
+      cyw43_arch_wait_for_work_until(at_the_end_of_time);
+    }
+    delete state;
+  }
+
+  inline static ClockCore core;
+  inline static Display display;
+  // Core 0 work, run by the async context of cyw43_arch: from
+  // cyw43_arch_poll() under the poll arch, or from a low-priority interrupt
+  // as soon as it is due under the threadsafe_background arch. Either way
+  // one worker runs at a time, holding the context's lock.
+  inline static async_when_pending_worker_t second_worker;  //!< SecondTick ticked
+  inline static async_at_time_worker_t wifi_worker;
+  inline static async_at_time_worker_t journal_write_worker;  //!< writes an entry or erases ahead
+  inline static async_at_time_worker_t journal_refresh_worker;  //!< keeps the journal's time recent
+};
+
+#endif  // CLOCK_APP_HPP
@@ -0,0 +1,168 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef CLOCK_DISCIPLINE_HPP
+#define CLOCK_DISCIPLINE_HPP
+
+#include <cstdint>
+
+#include "ntp_time.hpp"
+
+// Software timebase that maps time_us_64() to Unix time in microseconds,
+// disciplined by NTP samples in the spirit of RFC 5905's clock discipline.
+//
+// The first sample, or one that is off by more than the step threshold,
+// steps the timebase. Smaller errors are slewed in at no more than 500 ppm,
+// so the displayed seconds never jump. A large error may take longer to
+// slew out than the time to the next sample; what is still to go then is
+// phase, and only the error beyond it is taken as the crystal's frequency
+// error since the last sample. A step of the reference's phase shows up
+// in one such estimate only, a frequency error in every one, so just what
+// two estimates in a row agree on is fed back into a frequency correction
+// (FLL). The poll interval doubles from 64 s up to 1024 s while samples
+// keep agreeing with the timebase within their error bound, and halves
+// again when they do not.
+class ClockDiscipline {
+public:
+  static constexpr int64_t step_threshold_us = 128000;
+  static constexpr int64_t max_slew_ppb = 500000;
+  static constexpr int64_t max_frequency_ppb = 500000;
+  static constexpr int fll_gain_shift = 2;      //!< frequency follows 1/4 of each estimate
+  static constexpr int min_poll_exponent = 6;   //!< 64 s
+  static constexpr int max_poll_exponent = 10;  //!< 1024 s
+  static constexpr int stable_polls = 4;        //!< agreeing samples before backing off
+  static constexpr int64_t min_fll_interval_us = 32000000;  //!< half the shortest poll
+
+  // The timebase runs, on a sample or a restored time.
+  bool synchronised() const { return valid; }
+
+  // The timebase runs on a sample, not on a restored time alone.
+  bool confirmed() const { return valid && !restored; }
+
+  // Starts the timebase from a time kept from before, such as across a
+  // power cycle, at time_us_64() value `local_us`, with the frequency
+  // correction learned then. The time can be shown right away, but is not
+  // trusted: the first sample steps the timebase whatever its error.
+  void restore(uint64_t local_us, int64_t utc_us, int64_t frequency_ppb) {
+    base_local_us = local_us;
+    base_utc_us = utc_us;
+    this->frequency_ppb = frequency_ppb;
+    slew_us = 0;
+    valid = true;
+    restored = true;
+  }
+
+  // Unix time in microseconds at time_us_64() value `local_us`; before the
+  // first sample this is simply `local_us`.
+  int64_t utc_us(uint64_t local_us) const {
+    int64_t elapsed = static_cast<int64_t>(local_us - base_local_us);
+    return base_utc_us + elapsed + elapsed * frequency_ppb / 1000000000 + slewed_us(elapsed);
+  }
+
+  // time_us_64() value at which the timebase will reach `target_utc_us`,
+  // or reached it, assuming it keeps its rate at `now_us`. Meant for
+  // targets within a second or so of `now_us`.
+  uint64_t local_us_at(int64_t target_utc_us, uint64_t now_us) const {
+    int64_t elapsed = static_cast<int64_t>(now_us - base_local_us);
+    int64_t rate_ppb = frequency_ppb;
+    if (slewed_us(elapsed) != slew_us) {
+      rate_ppb += slew_us > 0 ? max_slew_ppb : -max_slew_ppb;
+    }
+    int64_t ahead_us = target_utc_us - utc_us(now_us);
+    return now_us + static_cast<uint64_t>(ahead_us * 1000000000 / (1000000000 + rate_ppb));
+  }
+
+  // Feeds the sample of an exchange that completed at `local_us`. Returns
+  // true if the timebase was stepped rather than slewed.
+  bool update(uint64_t local_us, const NtpSample &sample) {
+    int64_t offset_us = utc_us(local_us) - static_cast<int64_t>(local_us);
+    last_error_us = sample.offset_us - offset_us;
+    int64_t magnitude_us = last_error_us < 0 ? -last_error_us : last_error_us;
+
+    if (!valid || restored || magnitude_us > step_threshold_us) {
+      if (!valid) {
+        last_error_us = 0;  // nothing to compare against yet
+      }
+      restored = false;
+      base_local_us = local_us;
+      base_utc_us = static_cast<int64_t>(local_us) + sample.offset_us;
+      slew_us = 0;
+      last_drift_ppb = 0;
+      poll_exponent = min_poll_exponent;
+      stable_count = 0;
+      valid = true;
+      return true;
+    }
+
+    int64_t interval_us = static_cast<int64_t>(local_us - base_local_us);
+    // The part of the last error not slewed out yet is still in this one.
+    int64_t drift_us = last_error_us - (slew_us - slewed_us(interval_us));
+    base_utc_us = utc_us(local_us);
+    base_local_us = local_us;
+    slew_us = last_error_us;
+    // Updates in quick succession, as in a startup burst, only correct the
+    // phase; network jitter would swamp any frequency error they show.
+    if (interval_us < min_fll_interval_us) {
+      return false;
+    }
+
+    // Without the phase still being slewed, what is left has built up since
+    // the last update and is down to the frequency error, or to a step of
+    // the reference. The median of this estimate, the one before and zero
+    // follows the first but not the second.
+    int64_t drift_ppb = drift_us * 1000000000 / interval_us;
+    int64_t agreed_ppb = 0;
+    if (drift_ppb > 0 && last_drift_ppb > 0) {
+      agreed_ppb = drift_ppb < last_drift_ppb ? drift_ppb : last_drift_ppb;
+    } else if (drift_ppb < 0 && last_drift_ppb < 0) {
+      agreed_ppb = drift_ppb > last_drift_ppb ? drift_ppb : last_drift_ppb;
+    }
+    last_drift_ppb = drift_ppb;
+    frequency_ppb += agreed_ppb >> fll_gain_shift;
+    if (frequency_ppb > max_frequency_ppb) {
+      frequency_ppb = max_frequency_ppb;
+    } else if (frequency_ppb < -max_frequency_ppb) {
+      frequency_ppb = -max_frequency_ppb;
+    }
+
+    // A sample cannot be trusted beyond half its round-trip delay.
+    if (magnitude_us <= sample.delay_us / 2) {
+      if (++stable_count >= stable_polls && poll_exponent < max_poll_exponent) {
+        poll_exponent++;
+        stable_count = 0;
+      }
+    } else if (magnitude_us > sample.delay_us) {
+      if (poll_exponent > min_poll_exponent) {
+        poll_exponent--;
+      }
+      stable_count = 0;
+    }
+    return false;
+  }
+
+  uint32_t poll_interval_s() const { return 1u << poll_exponent; }
+  int64_t frequency() const { return frequency_ppb; }
+  int64_t error() const { return last_error_us; }
+
+private:
+  // Part of `slew_us` worked off `elapsed` microseconds after the last update.
+  int64_t slewed_us(int64_t elapsed) const {
+    if (elapsed <= 0) {
+      return 0;
+    }
+    int64_t limit = elapsed * max_slew_ppb / 1000000000;
+    return slew_us > limit ? limit : (slew_us < -limit ? -limit : slew_us);
+  }
+
+  bool     valid = false;
+  bool     restored = false;    //!< runs on a kept time no sample has confirmed
+  uint64_t base_local_us = 0;   //!< time_us_64() of the last update
+  int64_t  base_utc_us = 0;     //!< timebase value at base_local_us
+  int64_t  frequency_ppb = 0;   //!< correction of the crystal's rate
+  int64_t  slew_us = 0;         //!< phase error being slewed out since the last update
+  int64_t  last_error_us = 0;   //!< sample offset minus timebase offset at the last update
+  int64_t  last_drift_ppb = 0;  //!< frequency error estimated at the last update
+  int      poll_exponent = min_poll_exponent;
+  int      stable_count = 0;
+};
+
+#endif  // CLOCK_DISCIPLINE_HPP
@@ -0,0 +1,23 @@
+# cyw43 arch the clocks run their network and timed work on: under
+# threadsafe_background the async_context workers run from an interrupt as
+# soon as they are due, under poll from the main loop of core 0. The
+# firmware is the same code either way.
+
+set(NTP_RTC_CYW43_ARCH threadsafe_background CACHE STRING
+    "cyw43 arch of the clocks: threadsafe_background or poll")
+set_property(CACHE NTP_RTC_CYW43_ARCH PROPERTY STRINGS threadsafe_background poll)
+if(NOT NTP_RTC_CYW43_ARCH MATCHES "^(threadsafe_background|poll)$")
+  message(FATAL_ERROR "NTP_RTC_CYW43_ARCH must be threadsafe_background or poll")
+endif()
+
+# Builds `target` for the arch: links the SDK's cyw43_arch library for it,
+# or for the host simulator selects it as the SDK would. Either way what
+# links `target` is built for the arch too.
+function(ntp_rtc_cyw43_arch target)
+  if(TARGET pico_cyw43_arch_lwip_${NTP_RTC_CYW43_ARCH})
+    target_link_libraries(${target} pico_cyw43_arch_lwip_${NTP_RTC_CYW43_ARCH})
+  else()
+    string(TOUPPER ${NTP_RTC_CYW43_ARCH} arch)
+    target_compile_definitions(${target} PUBLIC PICO_CYW43_ARCH_${arch}=1)
+  endif()
+endfunction()
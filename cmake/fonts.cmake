@@ -0,0 +1,26 @@
+# Font pipeline: tools/font_compiler turns the font sources in fonts/ into
+# headers with constexpr glyph atlases (see glyph.hpp) at build time, so
+# fonts are edited as ASCII art or taken from BDF files rather than written
+# as C++ tables.
+
+include(${CMAKE_CURRENT_LIST_DIR}/host_tool.cmake)
+ntp_rtc_host_tool(font_compiler)
+
+# Compiles fonts/<source> into <name>.hpp, which `target` can then include
+# for the atlas `name`. GLYPHS limits the atlas to the characters given,
+# which must not include a semicolon.
+function(ntp_rtc_font target name source)
+  cmake_parse_arguments(FONT "" "GLYPHS" "" ${ARGN})
+  set(header_dir ${CMAKE_CURRENT_BINARY_DIR}/fonts/${target})
+  set(header ${header_dir}/${name}.hpp)
+  add_custom_command(OUTPUT ${header}
+          COMMAND ${CMAKE_COMMAND} -E make_directory ${header_dir}
+          COMMAND font_compiler fonts/${source} ${header} ${name} ${FONT_GLYPHS}
+          DEPENDS font_compiler ${NTP_RTC_SOURCE_DIR}/fonts/${source}
+          WORKING_DIRECTORY ${NTP_RTC_SOURCE_DIR}
+          COMMENT "Compiling font ${source} for ${target}"
+          VERBATIM
+          )
+  target_sources(${target} PRIVATE ${header})
+  target_include_directories(${target} PRIVATE ${header_dir})
+endfunction()
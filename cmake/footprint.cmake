@@ -0,0 +1,61 @@
+# Footprint report: after each link, prints how much flash and RAM an
+# executable takes, from the `size` tool of the toolchain in use, so that
+# regressions show in every build. Setting NTP_RTC_FLASH_BUDGET or
+# NTP_RTC_RAM_BUDGET (bytes) also fails the build when one is exceeded.
+# The ntp_rtc_size_report target compares all executables at once against
+# a baseline that ntp_rtc_size_baseline saved, such as before a change.
+
+set(NTP_RTC_FLASH_BUDGET "" CACHE STRING "Flash budget per executable in bytes, empty for none")
+set(NTP_RTC_RAM_BUDGET "" CACHE STRING "RAM budget per executable in bytes, empty for none")
+set(NTP_RTC_SIZE_BASELINE ${CMAKE_BINARY_DIR}/size_baseline.txt CACHE FILEPATH
+    "Footprints ntp_rtc_size_report compares against")
+
+string(REGEX REPLACE "objdump([.a-z]*)$" "size\\1" NTP_RTC_SIZE "${CMAKE_OBJDUMP}")
+set(NTP_RTC_FOOTPRINT_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/footprint_report.cmake)
+set(NTP_RTC_SIZE_REPORT_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/size_report.cmake)
+
+function(ntp_rtc_footprint target)
+  if(NOT EXISTS "${NTP_RTC_SIZE}")
+    message(STATUS "${target}: no size tool next to ${CMAKE_OBJDUMP}, no footprint report")
+    return()
+  endif()
+  add_custom_command(TARGET ${target} POST_BUILD
+          COMMAND ${CMAKE_COMMAND}
+                  -DSIZE=${NTP_RTC_SIZE}
+                  -DFILE=$<TARGET_FILE:${target}>
+                  -DFLASH_BUDGET=${NTP_RTC_FLASH_BUDGET}
+                  -DRAM_BUDGET=${NTP_RTC_RAM_BUDGET}
+                  -P ${NTP_RTC_FOOTPRINT_SCRIPT}
+          VERBATIM
+          )
+endfunction()
+
+# Adds the targets ntp_rtc_size_report, which prints the footprint of each
+# of the executable targets given next to its baseline, and
+# ntp_rtc_size_baseline, which saves their footprints as the baseline.
+function(ntp_rtc_size_report)
+  if(NOT EXISTS "${NTP_RTC_SIZE}")
+    return()
+  endif()
+  set(files "")
+  foreach(target ${ARGN})
+    list(APPEND files $<TARGET_FILE:${target}>)
+  endforeach()
+  string(REPLACE ";" "|" files "${files}")
+  foreach(mode report baseline)
+    set(save 0)
+    if(mode STREQUAL baseline)
+      set(save 1)
+    endif()
+    add_custom_target(ntp_rtc_size_${mode}
+            COMMAND ${CMAKE_COMMAND}
+                    -DSIZE=${NTP_RTC_SIZE}
+                    -DFILES=${files}
+                    -DBASELINE=${NTP_RTC_SIZE_BASELINE}
+                    -DSAVE=${save}
+                    -P ${NTP_RTC_SIZE_REPORT_SCRIPT}
+            DEPENDS ${ARGN}
+            VERBATIM
+            )
+  endforeach()
+endfunction()
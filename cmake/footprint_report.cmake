@@ -0,0 +1,32 @@
+# Post-build step of ntp_rtc_footprint(), see footprint.cmake. Flash is
+# code, constants and the initial values of variables (text + data), RAM is
+# variables with and without initial values (data + bss), as `size` counts
+# them.
+#
+#   cmake -DSIZE=<size tool> -DFILE=<executable>
+#         [-DFLASH_BUDGET=<bytes>] [-DRAM_BUDGET=<bytes>] -P footprint_report.cmake
+
+execute_process(COMMAND ${SIZE} -B ${FILE}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+        )
+# Berkeley format: header line, then "text data bss dec hex filename"
+if(NOT result EQUAL 0 OR NOT output MATCHES "\n *([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)")
+  message(WARNING "footprint: cannot read sizes of ${FILE}")
+  return()
+endif()
+set(text ${CMAKE_MATCH_1})
+set(data ${CMAKE_MATCH_2})
+set(bss ${CMAKE_MATCH_3})
+math(EXPR flash "${text} + ${data}")
+math(EXPR ram "${data} + ${bss}")
+
+get_filename_component(name ${FILE} NAME)
+message("footprint ${name}: flash ${flash} B (text ${text}, data ${data}), "
+        "RAM ${ram} B (data ${data}, bss ${bss})")
+if(FLASH_BUDGET AND flash GREATER FLASH_BUDGET)
+  message(FATAL_ERROR "footprint ${name}: flash ${flash} B exceeds the budget of ${FLASH_BUDGET} B")
+endif()
+if(RAM_BUDGET AND ram GREATER RAM_BUDGET)
+  message(FATAL_ERROR "footprint ${name}: RAM ${ram} B exceeds the budget of ${RAM_BUDGET} B")
+endif()
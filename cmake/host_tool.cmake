@@ -0,0 +1,30 @@
+# Host tools run during the build, such as tools/font_compiler: built as
+# part of the host simulator, or for the firmware with the build machine's
+# own compiler through ExternalProject, as the SDK does for pioasm.
+
+set(NTP_RTC_SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR}/..)
+
+# Makes tools/<tool> available as the executable target <tool>.
+function(ntp_rtc_host_tool tool)
+  if(TARGET ${tool})
+    return()
+  endif()
+  if(CMAKE_CROSSCOMPILING)
+    include(ExternalProject)
+    set(tool_dir ${CMAKE_BINARY_DIR}/${tool})
+    ExternalProject_Add(${tool}_build
+            SOURCE_DIR ${NTP_RTC_SOURCE_DIR}/tools/${tool}
+            BINARY_DIR ${tool_dir}
+            CMAKE_ARGS "-DCMAKE_MAKE_PROGRAM:FILEPATH=${CMAKE_MAKE_PROGRAM}"
+            BUILD_ALWAYS 1
+            INSTALL_COMMAND ""
+            BUILD_BYPRODUCTS ${tool_dir}/${tool}${CMAKE_HOST_EXECUTABLE_SUFFIX}
+            )
+    add_executable(${tool} IMPORTED GLOBAL)
+    set_property(TARGET ${tool} PROPERTY IMPORTED_LOCATION
+            ${tool_dir}/${tool}${CMAKE_HOST_EXECUTABLE_SUFFIX})
+    add_dependencies(${tool} ${tool}_build)
+  else()
+    add_subdirectory(${NTP_RTC_SOURCE_DIR}/tools/${tool} ${CMAKE_BINARY_DIR}/${tool})
+  endif()
+endfunction()
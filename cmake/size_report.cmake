@@ -0,0 +1,58 @@
+# Script of the ntp_rtc_size_report and ntp_rtc_size_baseline targets, see
+# footprint.cmake. Prints the flash and RAM of each executable, counted as
+# by footprint_report.cmake, next to the numbers in the baseline file, or
+# with SAVE writes them to it instead.
+#
+#   cmake -DSIZE=<size tool> -DFILES=<executable>|... -DBASELINE=<file>
+#         [-DSAVE=1] -P size_report.cmake
+
+string(REPLACE "|" ";" files "${FILES}")
+
+set(baseline "")
+if(EXISTS ${BASELINE})
+  file(STRINGS ${BASELINE} baseline)
+endif()
+
+set(saved "")
+foreach(file ${files})
+  get_filename_component(name ${file} NAME_WE)
+  execute_process(COMMAND ${SIZE} -B ${file}
+          OUTPUT_VARIABLE output
+          RESULT_VARIABLE result
+          )
+  if(NOT result EQUAL 0 OR NOT output MATCHES "\n *([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)")
+    message(WARNING "size report: cannot read sizes of ${file}")
+    continue()
+  endif()
+  math(EXPR flash "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+  math(EXPR ram "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+  list(APPEND saved "${name} ${flash} ${ram}")
+
+  set(before "")
+  foreach(line ${baseline})
+    if(line MATCHES "^${name} ([0-9]+) ([0-9]+)$")
+      math(EXPR flash_change "${flash} - ${CMAKE_MATCH_1}")
+      math(EXPR ram_change "${ram} - ${CMAKE_MATCH_2}")
+      if(flash_change GREATER_EQUAL 0)
+        set(flash_change "+${flash_change}")
+      endif()
+      if(ram_change GREATER_EQUAL 0)
+        set(ram_change "+${ram_change}")
+      endif()
+      set(before " (baseline ${CMAKE_MATCH_1} B, ${flash_change} B), RAM ${ram} B (baseline ${CMAKE_MATCH_2} B, ${ram_change} B)")
+    endif()
+  endforeach()
+  if(SAVE OR before STREQUAL "")
+    message("size ${name}: flash ${flash} B, RAM ${ram} B")
+  else()
+    message("size ${name}: flash ${flash} B${before}")
+  endif()
+endforeach()
+
+if(SAVE)
+  string(REPLACE ";" "\n" saved "${saved}")
+  file(WRITE ${BASELINE} "${saved}\n")
+  message("size report: baseline saved to ${BASELINE}")
+elseif(baseline STREQUAL "")
+  message("size report: no baseline in ${BASELINE}, build ntp_rtc_size_baseline first")
+endif()
@@ -0,0 +1,35 @@
+# Time zones: tools/tz_compiler turns the rules in force today of the zones
+# in NTP_RTC_TIME_ZONES into a header with a constexpr TimeZoneTable (see
+# time_zone.hpp) at build time. The clock starts in NTP_RTC_TIME_ZONE and
+# can be switched to any other zone of the table while it runs.
+
+include(${CMAKE_CURRENT_LIST_DIR}/host_tool.cmake)
+ntp_rtc_host_tool(tz_compiler)
+
+set(NTP_RTC_TZDATA ${NTP_RTC_SOURCE_DIR}/zones/tzdata.zi CACHE FILEPATH
+    "zic input to compile the time zones from, such as a full tzdata.zi")
+set(NTP_RTC_TIME_ZONES
+    Europe/Zurich Europe/Berlin Europe/London Europe/Dublin Europe/Helsinki
+    America/New_York America/Chicago America/Denver America/Los_Angeles
+    America/Sao_Paulo Asia/Kolkata Asia/Tokyo Australia/Sydney Pacific/Auckland UTC
+    CACHE STRING "time zones the clock can be switched between")
+set(NTP_RTC_TIME_ZONE Europe/Zurich CACHE STRING "time zone the clock starts in")
+
+# Compiles the zones into <name>.hpp, which `target` can then include for
+# the table `name`, and tells `target` the starting zone as
+# NTP_RTC_TIME_ZONE.
+function(ntp_rtc_time_zones target name)
+  set(header_dir ${CMAKE_CURRENT_BINARY_DIR}/zones/${target})
+  set(header ${header_dir}/${name}.hpp)
+  add_custom_command(OUTPUT ${header}
+          COMMAND ${CMAKE_COMMAND} -E make_directory ${header_dir}
+          COMMAND tz_compiler ${NTP_RTC_TZDATA} ${header} ${name} ${NTP_RTC_TIME_ZONES}
+          DEPENDS tz_compiler ${NTP_RTC_TZDATA}
+          WORKING_DIRECTORY ${NTP_RTC_SOURCE_DIR}
+          COMMENT "Compiling time zones for ${target}"
+          VERBATIM
+          )
+  target_sources(${target} PRIVATE ${header})
+  target_include_directories(${target} PRIVATE ${header_dir})
+  target_compile_definitions(${target} PRIVATE NTP_RTC_TIME_ZONE=\"${NTP_RTC_TIME_ZONE}\")
+endfunction()
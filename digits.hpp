@@ -1,120 +0,0 @@
-// (c) 2023 Rene Mueller, Zofingen, Switzerland
-
-#ifndef DIGITS_HPP
-#define DIGITS_HPP
-
-constexpr char digits[] = {
-  // 1234567
-  "  000  "
-  " 0   0 "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  "0     0"
-  "0     0"
-  "0     0"
-  " 0   0 "
-  " 0   0 "
-  "  000  "
-  "   00  "
-  "  0 0  "
-  "  0 0  "
-  " 0  0  "
-  " 0  0  "
-  "0   0  "
-  "    0  "
-  "    0  "
-  "    0  "
-  "    0  "
-  "   000 "
-  "  000  "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  "      0"
-  "     0 "
-  "   00  "
-  "  0    "
-  " 0     "
-  "0      "
-  "0000000"
-  "  000  "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  "     0 "
-  "    0  "
-  "     0 "
-  "0     0"
-  "0     0"
-  " 0   0 "
-  "  000  "
-  "   00  "
-  "  0 0  "
-  "  0 0  "
-  " 0  0  "
-  " 0  0  "
-  "0   0  "
-  "0000000"
-  "    0  "
-  "    0  "
-  "    0  "
-  "   000 "
-  "0000000"
-  "0      "
-  "0      "
-  "0      "
-  "00000  "
-  "     0 "
-  "      0"
-  "      0"
-  "0     0"
-  " 0   0 "
-  "  000  "
-  "  000  "
-  " 0   0 "
-  " 0    0"
-  "0     0"
-  "0      "
-  "0 000  "
-  "00   0 "
-  "0     0"
-  "0     0"
-  " 0   0 "
-  "  000  "
-  "0000000"
-  "      0"
-  "      0"
-  "     0 "
-  "    0  "
-  "   0   "
-  "  0    "
-  "  0    "
-  " 0     "
-  " 0     "
-  " 0     "
-  "  000  "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  " 0   0 "
-  "  000  "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  " 0   0 "
-  "  000  "
-  "  000  "
-  " 0   0 "
-  "0     0"
-  "0     0"
-  " 0   00"
-  "  000 0"
-  "      0"
-  "0     0"
-  "0    0 "
-  " 0   0 "
-  "  000  "
-};
-
-#endif  // DIGITS_HPP
@@ -0,0 +1,137 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef DNS_CACHE_HPP
+#define DNS_CACHE_HPP
+
+#include <cstring>
+
+#include "lwip/dns.h"
+#include "pico/stdlib.h"
+
+// Name lookups in front of dns_gethostbyname(). Each name keeps the last
+// few distinct addresses it resolved to. Within the TTL a lookup is served
+// from memory without any traffic; after it the current address is still
+// served while a refresh runs in the background, and when that refresh
+// fails the name simply stays on its last known good address.
+//
+// lwIP does not hand the TTL of a record to its callers, so all entries
+// live for the same fixed time. Hostnames must outlive the cache.
+class DnsCache {
+public:
+  static constexpr int max_names = 4;
+  static constexpr int max_addresses = 4;
+  static constexpr uint32_t ttl_ms = 60 * 60 * 1000;
+
+  // Same contract as dns_gethostbyname(): ERR_OK with `addr` filled in,
+  // ERR_INPROGRESS if `found` will be called, or an error.
+  err_t lookup(const char *hostname, ip_addr_t *addr, dns_found_callback found,
+               void *callback_arg) {
+    Entry *entry = find(hostname);
+    if (!entry) {
+      return dns_gethostbyname(hostname, addr, found, callback_arg);  // cache full
+    }
+    if (entry->count > 0) {
+      *addr = entry->addresses[entry->current];
+      if (time_reached(entry->expires) && !entry->refreshing) {
+        ip_addr_t refreshed;
+        refresh(entry, &refreshed, nullptr, nullptr);
+      }
+      return ERR_OK;
+    }
+    if (entry->refreshing) {
+      entry->found = found;
+      entry->callback_arg = callback_arg;
+      return ERR_INPROGRESS;
+    }
+    return refresh(entry, addr, found, callback_arg);
+  }
+
+  // Gives up on `addr` for `hostname`, e.g. because the server stopped
+  // answering: the name moves on to its next known address and is looked
+  // up again on its next use.
+  void reject(const char *hostname, const ip_addr_t *addr) {
+    Entry *entry = find(hostname);
+    if (entry && entry->count > 0 && ip_addr_cmp(&entry->addresses[entry->current], addr)) {
+      entry->current = (entry->current + 1) % entry->count;
+      entry->expires = get_absolute_time();
+    }
+  }
+
+private:
+  struct Entry {
+    const char        *hostname;
+    ip_addr_t          addresses[max_addresses];  //!< distinct addresses seen, newest in `next - 1`
+    uint8_t            count;
+    uint8_t            next;           //!< slot the next new address goes into
+    uint8_t            current;        //!< address handed out
+    bool               refreshing;     //!< lookup in flight
+    absolute_time_t    expires;
+    dns_found_callback found;          //!< caller waiting for the first address, if any
+    void              *callback_arg;
+  };
+
+  Entry *find(const char *hostname) {
+    for (Entry &entry : entries) {
+      if (entry.hostname && strcmp(entry.hostname, hostname) == 0) {
+        return &entry;
+      }
+    }
+    for (Entry &entry : entries) {
+      if (!entry.hostname) {
+        entry.hostname = hostname;
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  static void store(Entry *entry, const ip_addr_t *addr) {
+    entry->expires = make_timeout_time_ms(ttl_ms);
+    for (int i = 0; i < entry->count; i++) {
+      if (ip_addr_cmp(&entry->addresses[i], addr)) {
+        entry->current = i;
+        return;
+      }
+    }
+    entry->addresses[entry->next] = *addr;
+    entry->current = entry->next;
+    entry->next = (entry->next + 1) % max_addresses;
+    if (entry->count < max_addresses) {
+      entry->count++;
+    }
+  }
+
+  static err_t refresh(Entry *entry, ip_addr_t *addr, dns_found_callback found,
+                       void *callback_arg) {
+    entry->found = found;
+    entry->callback_arg = callback_arg;
+    entry->refreshing = true;
+    err_t err = dns_gethostbyname(entry->hostname, addr, resolved, entry);
+    if (err != ERR_INPROGRESS) {
+      entry->refreshing = false;
+      entry->found = nullptr;
+    }
+    if (err == ERR_OK) {
+      store(entry, addr);
+    }
+    return err;
+  }
+
+  static void resolved(const char *hostname, const ip_addr_t *ipaddr, void *arg) {
+    Entry *entry = (Entry *)arg;
+    entry->refreshing = false;
+    if (ipaddr) {
+      store(entry, ipaddr);
+    }
+    dns_found_callback found = entry->found;
+    entry->found = nullptr;
+    if (found) {
+      found(hostname, entry->count > 0 ? &entry->addresses[entry->current] : nullptr,
+            entry->callback_arg);
+    }
+  }
+
+  Entry entries[max_names];
+};
+
+#endif  // DNS_CACHE_HPP
@@ -0,0 +1,190 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef FLASH_JOURNAL_HPP
+#define FLASH_JOURNAL_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "hardware/flash.h"
+
+// Log-structured store for a small record in the last `Sectors` sectors
+// of flash. Each write appends an entry behind the latest one, and the
+// ring only comes back to the start of a sector, erasing it, once the
+// sector before is full, so erases are spread over all sectors and happen
+// once per sector's worth of writes. At boot the entry with the highest
+// sequence number and a good CRC wins; an entry torn by a power cut fails
+// the CRC and the one before it is used.
+//
+// Entries are read through XIP. Erasing and programming stall XIP, so
+// prepare() and append() must be called with interrupts disabled and the
+// other core locked out or known not to run from flash. Erasing a sector
+// takes far longer than programming a page (45 ms typically and 400 ms at
+// most against 0.4 ms and 3 ms on the Pico W's W25Q16JV), so it is split
+// off: prepare() erases the sector the next entry goes into whenever
+// erase_due(), at a time that suits the caller, and append() then only
+// programs a page.
+template <typename Payload, int Sectors>
+class FlashJournal {
+  static_assert(Sectors >= 2, "the latest entry must survive erasing a sector");
+
+  struct Header {
+    uint32_t magic;
+    uint32_t sequence;  //!< counts up with each entry written
+    uint32_t size;      //!< of the payload
+    uint32_t crc;       //!< CRC-32 of sequence, size and payload
+  };
+
+public:
+  static constexpr uint32_t used_size = sizeof(Header) + sizeof(Payload);
+  static constexpr uint32_t entry_size = used_size <= 32 ? 32 : (used_size <= 64 ? 64 : 128);
+  static constexpr uint32_t region_offset = PICO_FLASH_SIZE_BYTES - Sectors * FLASH_SECTOR_SIZE;
+  static constexpr int entries_per_sector = FLASH_SECTOR_SIZE / entry_size;
+  static constexpr int num_entries = Sectors * entries_per_sector;
+
+  static_assert(used_size <= entry_size, "payload too large");
+  static_assert(FLASH_PAGE_SIZE % entry_size == 0, "entries must not straddle pages");
+
+  // Scans the journal; returns true and the latest payload in `latest` if
+  // there is one. Call once before appending.
+  bool open(Payload *latest) {
+    bool found = false;
+    for (int i = 0; i < num_entries; i++) {
+      Header header;
+      if (!valid(i, &header) || (found && header.sequence <= sequence)) {
+        continue;
+      }
+      found = true;
+      sequence = header.sequence;
+      next_entry = (i + 1) % num_entries;
+      memcpy(latest, entry(i) + sizeof(Header), sizeof(Payload));
+    }
+    erase_pending = needs_erase();
+    return found;
+  }
+
+  // Whether the next append() would have to erase a sector first
+  bool erase_due() const { return erase_pending; }
+
+  // Moves on to the entry the next append() writes, erasing its sector if
+  // need be.
+  void prepare() {
+    // Entries left by a write that was cut short are skipped up to the
+    // next sector, which then gets erased like any other.
+    for (int tries = 0; tries < num_entries; tries++) {
+      if (next_entry % entries_per_sector == 0 && !blank(next_entry, entries_per_sector)) {
+        flash_range_erase(offset(next_entry), FLASH_SECTOR_SIZE);
+        erases++;
+      }
+      if (blank(next_entry, 1)) {
+        break;
+      }
+      next_entry = (next_entry + 1) % num_entries;
+    }
+    erase_pending = false;
+  }
+
+  // Writes `payload` as the latest entry; false if it did not read back.
+  // Erases a sector first unless prepare() did so.
+  bool append(const Payload &payload) {
+    prepare();
+
+    Header header = {.magic = magic, .sequence = sequence + 1, .size = sizeof(Payload), .crc = 0};
+    header.crc = crc(header, reinterpret_cast<const uint8_t *>(&payload));
+    // The rest of the page stays erased, so programming it leaves the
+    // entries already there alone.
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xff, sizeof(page));
+    uint32_t in_page = offset(next_entry) % FLASH_PAGE_SIZE;
+    memcpy(page + in_page, &header, sizeof(header));
+    memcpy(page + in_page + sizeof(header), &payload, sizeof(Payload));
+    flash_range_program(offset(next_entry) - in_page, page, FLASH_PAGE_SIZE);
+
+    bool written = memcmp(entry(next_entry), page + in_page, used_size) == 0;
+    sequence++;
+    next_entry = (next_entry + 1) % num_entries;
+    erase_pending = needs_erase();
+    return written;
+  }
+
+  uint32_t erase_count() const { return erases; }
+
+private:
+  static constexpr uint32_t magic = 0x4a505452;  //!< "RTPJ"
+
+  static uint32_t offset(int i) { return region_offset + static_cast<uint32_t>(i) * entry_size; }
+
+  static const uint8_t *entry(int i) {
+    return reinterpret_cast<const uint8_t *>(XIP_BASE + offset(i));
+  }
+
+  // Whether prepare() would erase a sector, see there
+  bool needs_erase() const {
+    for (int i = next_entry, tries = 0; tries < num_entries; i = (i + 1) % num_entries, tries++) {
+      if (i % entries_per_sector == 0 && !blank(i, entries_per_sector)) {
+        return true;
+      }
+      if (blank(i, 1)) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // Whether the `count` entries from `first` on are all erased
+  static bool blank(int first, int count) {
+    const uint8_t *bytes = entry(first);
+    for (uint32_t i = 0; i < count * entry_size; i++) {
+      if (bytes[i] != 0xff) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool valid(int i, Header *header) {
+    memcpy(header, entry(i), sizeof(Header));
+    return header->magic == magic && header->size == sizeof(Payload) &&
+           header->crc == crc(*header, entry(i) + sizeof(Header));
+  }
+
+  static uint32_t crc(const Header &header, const uint8_t *payload) {
+    uint32_t value = 0xffffffff;
+    value = crc_update(value, reinterpret_cast<const uint8_t *>(&header.sequence), 8);
+    value = crc_update(value, payload, sizeof(Payload));
+    return ~value;
+  }
+
+  // CRC-32 (IEEE 802.3) bit by bit; there are only a few bytes to check.
+  static uint32_t crc_update(uint32_t value, const uint8_t *bytes, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      value ^= bytes[i];
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value >> 1) ^ (0xedb88320 & (0u - (value & 1)));
+      }
+    }
+    return value;
+  }
+
+  uint32_t sequence = 0;  //!< of the latest entry
+  int      next_entry = 0;
+  uint32_t erases = 0;
+  bool     erase_pending = false;  //!< the sector of the next entry needs erasing
+};
+
+// What the clock keeps across power cycles; defaults to the settings of a
+// clock that has none kept yet.
+struct ClockState {
+  int64_t  utc_us = 0;           //!< timebase when written
+  int32_t  frequency_ppb = 0;    //!< crystal frequency correction the timebase learned
+  uint32_t time_zone = 0;        //!< time_zone_id() of the zone's name
+  uint8_t  brightness = 0;       //!< manual brightness level
+  uint8_t  auto_brightness = 1;  //!< follows the light sensor
+  uint8_t  reserved[6] = {};     //!< zero
+};
+
+constexpr int journal_sectors = 2;
+constexpr uint32_t journal_interval_ms = 15 * 60 * 1000;  //!< keeps the saved time recent
+constexpr uint32_t journal_min_interval_ms = 60 * 1000;   //!< between writes of changed settings
+
+#endif  // FLASH_JOURNAL_HPP
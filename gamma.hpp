@@ -0,0 +1,50 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef GAMMA_HPP
+#define GAMMA_HPP
+
+#include <cstdint>
+
+// Gamma of the eye's response to light: a level that looks half as bright
+// as another emits about 0.5^2.2 = 22% of its light.
+constexpr double display_gamma = 2.2;
+
+// x^exponent for x in [0, 1] as a constant expression, so that gamma
+// curves can be tabulated at compile time; <cmath> is not constexpr.
+// Accurate to far better than the 8-bit tables it fills need.
+constexpr double gamma_pow(double x, double exponent) {
+  if (x <= 0) {
+    return 0;
+  }
+  // ln x = k ln 2 + ln m with m in [0.5, 1), and ln m = 2 atanh((m-1)/(m+1))
+  int k = 0;
+  while (x < 0.5) {
+    x *= 2;
+    k--;
+  }
+  double z = (x - 1) / (x + 1);
+  double ln_m = 0;
+  double power = z;
+  for (int n = 1; n < 40; n += 2) {
+    ln_m += power / n;
+    power *= z * z;
+  }
+  double y = exponent * (k * 0.693147180559945309 + 2 * ln_m);
+  // e^y = (e^(y/256))^256, with the Taylor series for the small argument
+  double small = y / 256;
+  double e = 1;
+  double term = 1;
+  for (int n = 1; n < 20; n++) {
+    term *= small / n;
+    e += term;
+  }
+  for (int i = 0; i < 8; i++) {
+    e *= e;
+  }
+  return e;
+}
+
+static_assert(gamma_pow(0.5, 2) > 0.2499999 && gamma_pow(0.5, 2) < 0.2500001, "x^2");
+static_assert(gamma_pow(1, display_gamma) > 0.9999999, "1^g");
+
+#endif  // GAMMA_HPP
@@ -0,0 +1,210 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef GLYPH_HPP
+#define GLYPH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+// Proportional bitmap font of the printable ASCII characters, one byte per
+// glyph row; bit x of a row is the pixel in column x, so the leftmost pixel
+// is the least significant bit. Atlases are generated at build time from
+// the sources in fonts/ by tools/font_compiler, see ntp_rtc_font() in
+// cmake/fonts.cmake.
+struct KernPair {
+  char   left;
+  char   right;
+  int8_t adjust;  //!< columns added to the gap between `left` and `right`
+};
+
+template <int Count, int Height, int Kerns>
+struct GlyphAtlas {
+  static_assert(Count >= 1 && Count <= 95, "glyphs are printable ASCII characters");
+  static_assert(Height >= 1, "glyphs need at least one row");
+
+  static constexpr int count = Count;
+  static constexpr int height = Height;
+  static constexpr char first_char = ' ';
+  static constexpr char last_char = '~';
+  static constexpr uint8_t missing = 0xff;
+
+  uint8_t  spacing;                         //!< columns between two glyphs
+  uint8_t  index[last_char - first_char + 1];  //!< glyph of each character, or `missing`
+  uint8_t  widths[Count];
+  uint8_t  rows[Count][Height];
+  KernPair kerns[Kerns > 0 ? Kerns : 1];
+
+  static constexpr uint8_t blank[Height] = {};
+
+  // Glyph of `c`, or `missing`. Characters the source has no glyph for map
+  // to the glyph of '?' if the atlas has one.
+  constexpr int find(char c) const {
+    return c >= first_char && c <= last_char ? index[c - first_char] : missing;
+  }
+
+  // Rows and width of the glyph of `c`; a character without one, in an
+  // atlas without '?', has blank rows and no width.
+  constexpr const uint8_t *glyph(char c) const {
+    int i = find(c);
+    return i < Count ? rows[i] : blank;
+  }
+  constexpr int width(char c) const {
+    int i = find(c);
+    return i < Count ? widths[i] : 0;
+  }
+
+  constexpr int kerning(char left, char right) const {
+    for (int i = 0; i < Kerns; i++) {
+      if (kerns[i].left == left && kerns[i].right == right) {
+        return kerns[i].adjust;
+      }
+    }
+    return 0;
+  }
+
+  // Columns from the left edge of `text` to the right edge of its last glyph.
+  constexpr int text_width(std::string_view text) const {
+    int x = 0;
+    char previous = 0;
+    for (char c : text) {
+      if (c == '\n') {
+        break;
+      }
+      if (find(c) == missing) {
+        continue;
+      }
+      if (previous) {
+        x += spacing + kerning(previous, c);
+      }
+      x += width(c);
+      previous = c;
+    }
+    return x;
+  }
+};
+
+// Sets the pixels of `count` packed rows with the current pen, the first row
+// at (x, y). Only set bits are visited. No clipping is done: callers place
+// glyphs inside the framebuffer.
+inline void blit_rows(pimoroni::PicoGraphics &graphics, int x, int y,
+                      const uint8_t *rows, int count) {
+  for (int row = 0; row < count; row++) {
+    for (unsigned bits = rows[row]; bits != 0; bits &= bits - 1) {
+      graphics.set_pixel(pimoroni::Point(x + __builtin_ctz(bits), y + row));
+    }
+  }
+}
+
+// Draws `text` up to its first newline with the current pen, the top left
+// corner of its first glyph at (x, y), through the same blitter as the clock
+// digits. Characters without a glyph are left out; the text is cut off
+// before the first glyph that would cross the right edge of the
+// framebuffer, the font must fit its height. Returns the column after the
+// last glyph drawn.
+template <int Count, int Height, int Kerns>
+int draw_text(pimoroni::PicoGraphics &graphics, const GlyphAtlas<Count, Height, Kerns> &font,
+              int x, int y, std::string_view text) {
+  char previous = 0;
+  for (char c : text) {
+    if (c == '\n') {
+      break;
+    }
+    if (font.find(c) == font.missing) {
+      continue;
+    }
+    int left = previous ? x + font.spacing + font.kerning(previous, c) : x;
+    if (left + font.width(c) > graphics.bounds.w) {
+      break;
+    }
+    blit_rows(graphics, left, y, font.glyph(c), Height);
+    x = left + font.width(c);
+    previous = c;
+  }
+  return x;
+}
+
+// A line of text that stays on the framebuffer between updates, such as
+// the time of the text clock. show() compares the new text with what is
+// drawn and redraws from the first character that differs on, since the
+// glyphs after it may move, clearing only the columns from there to the
+// end of the old text. Laid out and cut off like draw_text(). Anything
+// else drawing over the line must call invalidate().
+template <int Count, int Height, int Kerns>
+class TextLine {
+public:
+  static constexpr int max_chars = 32;  //!< further characters are left out
+
+  TextLine(const GlyphAtlas<Count, Height, Kerns> &font, int x, int y)
+      : font(font), x(x), y(y) {}
+
+  // Forgets what is drawn; the next show() clears the line to the right
+  // edge of the framebuffer and draws it all.
+  void invalidate() { invalid = true; }
+
+  // Shows `text` up to its first newline, glyphs in pen `foreground` on
+  // `background`. Returns false if it was drawn already and nothing changed.
+  bool show(pimoroni::PicoGraphics &graphics, std::string_view text, uint background,
+            uint foreground) {
+    // The characters that get a glyph, the same ones draw_text() draws
+    char shown[max_chars];
+    int count = 0;
+    int right = x;
+    for (char c : text) {
+      if (c == '\n' || count == max_chars) {
+        break;
+      }
+      if (font.find(c) == font.missing) {
+        continue;
+      }
+      right += (count ? font.spacing + font.kerning(shown[count - 1], c) : 0) + font.width(c);
+      if (right > graphics.bounds.w) {
+        break;
+      }
+      shown[count++] = c;
+    }
+    if (invalid) {
+      drawn = 0;
+      end = graphics.bounds.w;
+      invalid = false;
+    }
+    int same = 0;
+    while (same < count && same < drawn && shown[same] == chars[same]) {
+      same++;
+    }
+    if (same == count && same == drawn && end == (count ? ends[count - 1] : x)) {
+      return false;
+    }
+
+    int left = same ? ends[same - 1] : x;
+    if (end > left) {
+      graphics.set_pen(background);
+      graphics.rectangle(pimoroni::Rect(left, y, end - left, Height));
+    }
+    graphics.set_pen(foreground);
+    for (int i = same; i < count; i++) {
+      char c = shown[i];
+      int glyph_left = i ? ends[i - 1] + font.spacing + font.kerning(shown[i - 1], c) : x;
+      blit_rows(graphics, glyph_left, y, font.glyph(c), Height);
+      chars[i] = c;
+      ends[i] = static_cast<int16_t>(glyph_left + font.width(c));
+    }
+    drawn = count;
+    end = count ? ends[count - 1] : x;
+    return true;
+  }
+
+private:
+  const GlyphAtlas<Count, Height, Kerns> &font;
+  int     x;
+  int     y;
+  char    chars[max_chars];  //!< characters drawn
+  int16_t ends[max_chars];   //!< column after the glyph of each character drawn
+  int     drawn = 0;         //!< number of characters drawn
+  int     end = 0;           //!< columns from here on are clear
+  bool    invalid = true;    //!< what is drawn is not known
+};
+
+#endif  // GLYPH_HPP
@@ -0,0 +1,83 @@
+// Host check of civil_time.hpp against the C library: every day from 1600
+// to 2600 through civil_from_seconds() and gmtime_r(), at a second of the
+// day that walks through all hours, days_from_civil() back again, and a
+// whole day of TimeDigits::tick() against set(). Prints the first
+// mismatches and exits with status 1 if there are any.
+//
+// Needs a 64-bit time_t.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+
+#include "civil_time.hpp"
+
+namespace {
+
+constexpr int first_year = 1600;
+constexpr int last_year = 2600;
+constexpr int max_reports = 10;
+
+int failures = 0;
+
+void fail(const char *what, int64_t value) {
+  if (failures++ < max_reports) {
+    printf("mismatch: %s at %" PRId64 "\n", what, value);
+  }
+}
+
+void check_day(int64_t day) {
+  // 7919 s is prime to the length of a day, so the hours and minutes
+  // checked move on from day to day.
+  int64_t second = day * 86400 + (day * 7919 - floor_div(day * 7919, 86400) * 86400);
+  time_t epoch = static_cast<time_t>(second);
+  struct tm expected;
+  if (!gmtime_r(&epoch, &expected)) {
+    fail("gmtime_r", second);
+    return;
+  }
+  CivilTime t = civil_from_seconds(second);
+  if (t.year != expected.tm_year + 1900 || t.month != expected.tm_mon + 1 ||
+      t.day != expected.tm_mday || t.weekday != expected.tm_wday ||
+      t.hour != expected.tm_hour || t.minute != expected.tm_min ||
+      t.second != expected.tm_sec) {
+    fail("civil_from_seconds", second);
+  }
+  if (days_from_civil(t.year, t.month, t.day) != day) {
+    fail("days_from_civil", day);
+  }
+}
+
+void check_ticks() {
+  TimeDigits ticked;
+  ticked.set(0, 0, 0);
+  for (int second = 1; second <= 86400; second++) {
+    ticked.tick();
+    TimeDigits expected;
+    int wrapped = second % 86400;
+    expected.set(wrapped / 3600, wrapped / 60 % 60, wrapped % 60);
+    for (int i = 0; i < 6; i++) {
+      if (ticked.digits[i] != expected.digits[i]) {
+        fail("TimeDigits::tick", second);
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  static_assert(sizeof(time_t) >= 8, "the check runs past 2038");
+  int64_t first = days_from_civil(first_year, 1, 1);
+  int64_t last = days_from_civil(last_year, 12, 31);
+  for (int64_t day = first; day <= last; day++) {
+    check_day(day);
+  }
+  check_ticks();
+  printf("civil_time: %" PRId64 " days from %d to %d, %s\n", last - first + 1, first_year,
+         last_year, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
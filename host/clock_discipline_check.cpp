@@ -0,0 +1,79 @@
+// Host check of ClockDiscipline in clock_discipline.hpp: feeds it noiseless
+// samples of a crystal that runs off by a few ppm, with a single phase
+// step of the reference on the way, at the poll intervals it asks for.
+// The step comes either while polls are still 64 s apart, so that slewing
+// it out takes longer than a poll, or once the frequency has settled. The
+// frequency correction must not run off towards its limit while the step
+// is slewed out, and the error has to come down to within a millisecond.
+// Prints the cases that do not and exits with status 1 if there are any.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "clock_discipline.hpp"
+
+namespace {
+
+constexpr int polls = 40;                      //!< samples per case
+constexpr int early_poll = 2;                  //!< sample of an early step of the reference
+constexpr int settled_poll = 16;               //!< sample of a step once the frequency settled
+constexpr int64_t start_utc_us = 1700000000000000;
+constexpr int64_t settled_error_us = 1000;
+constexpr int64_t frequency_tolerance_ppb = 1000;
+
+int failures = 0;
+
+// `drift_ppb` is how much faster the crystal runs than it should, and
+// `step_us` how far the reference steps at sample `step_poll`.
+void check(int64_t drift_ppb, int64_t step_us, int step_poll) {
+  ClockDiscipline timebase;
+  uint64_t local_us = 1000000;
+  int64_t phase_us = 0;
+  int64_t peak_ppb = 0;
+  for (int poll = 0; poll < polls; poll++) {
+    if (poll == step_poll) {
+      phase_us += step_us;
+    }
+    // Reference time at `local_us` of a crystal that is `drift_ppb` fast
+    int64_t utc_us = start_utc_us + phase_us + static_cast<int64_t>(local_us) -
+                     static_cast<int64_t>(local_us) * drift_ppb / (1000000000 + drift_ppb);
+    NtpSample sample = { .offset_us = utc_us - static_cast<int64_t>(local_us), .delay_us = 2000 };
+    timebase.update(local_us, sample);
+    if (poll > step_poll) {
+      int64_t away_ppb = timebase.frequency() + drift_ppb;
+      away_ppb = away_ppb < 0 ? -away_ppb : away_ppb;
+      peak_ppb = away_ppb > peak_ppb ? away_ppb : peak_ppb;
+    }
+    local_us += static_cast<uint64_t>(timebase.poll_interval_s()) * 1000000;
+  }
+  int64_t error_us = timebase.error() < 0 ? -timebase.error() : timebase.error();
+  // An early step comes before the frequency settled, which may then still
+  // be off by up to the crystal's error.
+  int64_t bound_ppb = frequency_tolerance_ppb;
+  if (step_poll < settled_poll) {
+    bound_ppb += drift_ppb < 0 ? -drift_ppb : drift_ppb;
+  }
+  bool ok = peak_ppb <= bound_ppb && error_us <= settled_error_us;
+  printf("drift %+7" PRId64 " ppb, step %+7" PRId64 " us at sample %2d: frequency %+7" PRId64
+         " ppb, at most %6" PRId64 " ppb off after the step, error %+5" PRId64 " us, %s\n",
+         drift_ppb, step_us, step_poll, timebase.frequency(), peak_ppb, timebase.error(),
+         ok ? "ok" : "FAILED");
+  failures += !ok;
+}
+
+}  // namespace
+
+int main() {
+  const int64_t drifts_ppb[] = { 0, 20000, -35000 };
+  const int64_t steps_us[] = { 0, 30000, 100000, -120000 };
+  for (int64_t drift_ppb : drifts_ppb) {
+    for (int64_t step_us : steps_us) {
+      check(drift_ppb, step_us, early_poll);
+      check(drift_ppb, step_us, settled_poll);
+    }
+  }
+  printf("clock_discipline: %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+// Host stand-in for pimoroni-pico's GalacticUnicorn driver.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <algorithm>
+
+#include "galactic_unicorn.hpp"
+#include "sim.hpp"
+
+namespace pimoroni {
+
+  void GalacticUnicorn::init() {
+    clear();
+  }
+
+  void GalacticUnicorn::clear() {
+    std::fill(panel, panel + sizeof(panel), 0);
+    sim::panel_changed(panel, WIDTH, HEIGHT, 0);
+  }
+
+  void GalacticUnicorn::update(PicoGraphics *graphics) {
+    // Like the device driver, scale every pixel by the brightness on each
+    // update; the panel's bitplane conversion is not modelled.
+    if (graphics->pen_type != PicoGraphics::PEN_RGB888) {
+      return;
+    }
+    const uint32_t *src = static_cast<const uint32_t *>(graphics->frame_buffer);
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+      uint32_t c = src[i];
+      panel[i * 3 + 0] = (((c >> 16) & 0xff) * brightness) >> 8;
+      panel[i * 3 + 1] = (((c >> 8) & 0xff) * brightness) >> 8;
+      panel[i * 3 + 2] = ((c & 0xff) * brightness) >> 8;
+    }
+    sim::panel_changed(panel, WIDTH, HEIGHT, WIDTH * HEIGHT);
+  }
+
+  void GalacticUnicorn::set_pixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT) {
+      return;
+    }
+    uint8_t *rgb = &panel[(y * WIDTH + x) * 3];
+    rgb[0] = (r * brightness) >> 8;
+    rgb[1] = (g * brightness) >> 8;
+    rgb[2] = (b * brightness) >> 8;
+    sim::panel_changed(panel, WIDTH, HEIGHT, 1);
+  }
+
+  void GalacticUnicorn::set_brightness(float value) {
+    value = std::clamp(value, 0.0f, 1.0f);
+    brightness = static_cast<uint16_t>(value * 255.0f + 1);
+    sim::brightness_set(brightness);
+  }
+
+  float GalacticUnicorn::get_brightness() {
+    return brightness / 255.0f;
+  }
+
+  void GalacticUnicorn::adjust_brightness(float delta) {
+    set_brightness(get_brightness() + delta);
+  }
+
+  uint16_t GalacticUnicorn::light() {
+    return sim::light_reading();
+  }
+
+  bool GalacticUnicorn::is_pressed(uint8_t button) {
+    return false;
+  }
+
+}
@@ -0,0 +1,48 @@
+// Host stand-in for pimoroni-pico's GalacticUnicorn. What update() and
+// set_pixel() put on the panel is handed to the simulator, which keeps the
+// latest frame in memory and optionally dumps every frame as a PPM image.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#pragma once
+
+#include <cstdint>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+namespace pimoroni {
+
+  class GalacticUnicorn {
+  public:
+    static const int WIDTH  = 53;
+    static const int HEIGHT = 11;
+
+    static const uint8_t SWITCH_A               =  0;
+    static const uint8_t SWITCH_B               =  1;
+    static const uint8_t SWITCH_C               =  3;
+    static const uint8_t SWITCH_D               =  6;
+    static const uint8_t SWITCH_SLEEP           = 27;
+    static const uint8_t SWITCH_VOLUME_UP       =  7;
+    static const uint8_t SWITCH_VOLUME_DOWN     =  8;
+    static const uint8_t SWITCH_BRIGHTNESS_UP   = 21;
+    static const uint8_t SWITCH_BRIGHTNESS_DOWN = 26;
+
+  private:
+    uint16_t brightness = 256;
+    uint8_t panel[WIDTH * HEIGHT * 3] = {};  //!< what the LEDs show, after brightness
+
+  public:
+    void init();
+    void clear();
+    void update(PicoGraphics *graphics);
+    void set_pixel(int x, int y, uint8_t r, uint8_t g, uint8_t b);
+
+    void set_brightness(float value);
+    float get_brightness();
+    void adjust_brightness(float delta);
+
+    uint16_t light();
+    bool is_pressed(uint8_t button);
+  };
+
+}
@@ -0,0 +1,26 @@
+// Host stand-in for the Pico SDK's hardware/flash.h, and the flash layout
+// that comes with it from the board and address map headers. The flash is
+// an image in host memory, erased at start or loaded from
+// NTP_RTC_SIM_FLASH (see host/sim.hpp); erasing and programming keep the
+// calling core busy for the flash chip's typical times.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _HARDWARE_FLASH_H
+#define _HARDWARE_FLASH_H
+
+#include "pico/types.h"
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// Address at which XIP shows the flash; not a constant on the host.
+#define XIP_BASE (sim_flash_base())
+
+uintptr_t sim_flash_base(void);
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif  // _HARDWARE_FLASH_H
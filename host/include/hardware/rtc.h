@@ -0,0 +1,23 @@
+// Host stand-in for the Pico SDK's hardware/rtc.h. The simulated RTC
+// counts whole seconds from the virtual clock, like the RP2040's, starting
+// a new second every 1 s after it was loaded. Fields of an alarm set to -1
+// do not take part in the match.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _HARDWARE_RTC_H
+#define _HARDWARE_RTC_H
+
+#include "pico/types.h"
+
+typedef void (*rtc_callback_t)(void);
+
+void rtc_init(void);
+bool rtc_set_datetime(datetime_t *t);
+bool rtc_get_datetime(datetime_t *t);
+bool rtc_running(void);
+void rtc_set_alarm(datetime_t *t, rtc_callback_t user_callback);
+void rtc_enable_alarm(void);
+void rtc_disable_alarm(void);
+
+#endif  // _HARDWARE_RTC_H
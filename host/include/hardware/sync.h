@@ -0,0 +1,16 @@
+// Host stand-in for the Pico SDK's hardware/sync.h. Simulated interrupts
+// only run while the firmware idles, so masking them is a no-op.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include "pico/types.h"
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+void __sev(void);
+
+#endif  // _HARDWARE_SYNC_H
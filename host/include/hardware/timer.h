@@ -0,0 +1,16 @@
+// Host stand-in for the Pico SDK's hardware/timer.h. Busy waiting moves the
+// virtual clock on without running interrupts, so it is safe to use from an
+// alarm or RTC callback, as on the device.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _HARDWARE_TIMER_H
+#define _HARDWARE_TIMER_H
+
+#include "pico/types.h"
+
+void busy_wait_us(uint64_t delay_us);
+static inline void busy_wait_us_32(uint32_t delay_us) { busy_wait_us(delay_us); }
+static inline void busy_wait_ms(uint32_t delay_ms) { busy_wait_us(delay_ms * 1000ull); }
+
+#endif  // _HARDWARE_TIMER_H
@@ -0,0 +1,101 @@
+// Host stand-in for pimoroni-pico's PicoGraphics, reduced to the drawing
+// primitives and pen types the clock uses. Text is drawn with placeholder
+// glyphs of roughly the size of the real bitmap fonts.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "pico/types.h"
+
+namespace pimoroni {
+
+  struct RGB888 {
+    uint8_t r, g, b;
+  };
+
+  struct Point {
+    int32_t x = 0, y = 0;
+
+    Point() = default;
+    Point(int32_t x, int32_t y) : x(x), y(y) {}
+  };
+
+  struct Rect {
+    int32_t x = 0, y = 0, w = 0, h = 0;
+
+    Rect() = default;
+    Rect(int32_t x, int32_t y, int32_t w, int32_t h) : x(x), y(y), w(w), h(h) {}
+
+    bool empty() const { return w <= 0 || h <= 0; }
+    bool contains(const Point &p) const {
+      return p.x >= x && p.y >= y && p.x < x + w && p.y < y + h;
+    }
+    Rect intersection(const Rect &r) const;
+  };
+
+  class PicoGraphics {
+  public:
+    enum PenType {
+      PEN_1BIT,
+      PEN_3BIT,
+      PEN_P2,
+      PEN_P4,
+      PEN_P8,
+      PEN_RGB332,
+      PEN_RGB565,
+      PEN_RGB888,
+    };
+
+    void *frame_buffer;
+    PenType pen_type;
+    Rect bounds;
+    Rect clip;
+
+    PicoGraphics(uint16_t width, uint16_t height, void *frame_buffer)
+      : frame_buffer(frame_buffer), bounds(0, 0, width, height),
+        clip(0, 0, width, height) {}
+    virtual ~PicoGraphics() = default;
+
+    virtual void set_pen(uint c) = 0;
+    virtual void set_pen(uint8_t r, uint8_t g, uint8_t b) = 0;
+    virtual int create_pen(uint8_t r, uint8_t g, uint8_t b) { return 0; }
+    virtual void set_pixel(const Point &p) = 0;
+    virtual void set_pixel_span(const Point &p, uint l) = 0;
+
+    void set_font(const std::string_view &name) { font = name; }
+    void set_clip(const Rect &r) { clip = bounds.intersection(r); }
+    void remove_clip() { clip = bounds; }
+
+    void clear();
+    void pixel(const Point &p);
+    void pixel_span(const Point &p, int32_t l);
+    void rectangle(const Rect &r);
+    void text(const std::string_view &t, const Point &p, int32_t wrap,
+              float s = 2.0f, float a = 0.0f, uint8_t letter_spacing = 1,
+              bool fixed_width = false);
+
+  protected:
+    std::string font;
+  };
+
+  class PicoGraphics_PenRGB888 : public PicoGraphics {
+  public:
+    RGB888 color;
+
+    PicoGraphics_PenRGB888(uint16_t width, uint16_t height, void *frame_buffer);
+
+    void set_pen(uint c) override;
+    void set_pen(uint8_t r, uint8_t g, uint8_t b) override;
+    int create_pen(uint8_t r, uint8_t g, uint8_t b) override;
+    void set_pixel(const Point &p) override;
+    void set_pixel_span(const Point &p, uint l) override;
+
+    static size_t buffer_size(uint w, uint h) { return w * h * sizeof(uint32_t); }
+  };
+
+}
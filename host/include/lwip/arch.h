@@ -0,0 +1,29 @@
+// Host stand-in for lwIP's lwip/arch.h and lwip/err.h (the subset used by
+// the clock).
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef LWIP_HDR_ARCH_H
+#define LWIP_HDR_ARCH_H
+
+#include <stdint.h>
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+typedef s8_t err_t;
+
+#define ERR_OK          0
+#define ERR_MEM        -1
+#define ERR_BUF        -2
+#define ERR_TIMEOUT    -3
+#define ERR_RTE        -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL        -6
+#define ERR_ARG       -16
+
+#endif  // LWIP_HDR_ARCH_H
@@ -0,0 +1,18 @@
+// Host stand-in for lwIP's lwip/dns.h. Names resolve to the simulator's
+// stand-in NTP servers after a short virtual delay.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef LWIP_HDR_DNS_H
+#define LWIP_HDR_DNS_H
+
+#include "lwip/arch.h"
+#include "lwip/ip_addr.h"
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg);
+
+#endif  // LWIP_HDR_DNS_H
@@ -0,0 +1,28 @@
+// Host stand-in for lwIP's lwip/ip_addr.h in an IPv4-only configuration, as
+// built for the Pico W.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef LWIP_HDR_IP_ADDR_H
+#define LWIP_HDR_IP_ADDR_H
+
+#include "lwip/arch.h"
+
+typedef struct ip4_addr {
+  u32_t addr;  //!< network byte order
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#define IPADDR_TYPE_V4  0U
+#define IPADDR_TYPE_ANY 46U
+
+#define ip4_addr_get_u32(src_ipaddr) ((src_ipaddr)->addr)
+#define ip4_addr_set_u32(dest_ipaddr, src_u32) ((dest_ipaddr)->addr = (src_u32))
+#define ip_addr_cmp(addr1, addr2) ((addr1)->addr == (addr2)->addr)
+#define ip_addr_isany(addr) ((addr) == NULL || (addr)->addr == 0)
+#define ip_addr_set_zero(addr) ((addr)->addr = 0)
+#define ip_addr_copy(dest, src) ((dest) = (src))
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
+
+#endif  // LWIP_HDR_IP_ADDR_H
@@ -0,0 +1,43 @@
+// Host stand-in for lwIP's lwip/pbuf.h. Only single-segment pbufs are ever
+// created, but callers must not rely on that.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef LWIP_HDR_PBUF_H
+#define LWIP_HDR_PBUF_H
+
+#include "lwip/arch.h"
+
+typedef enum {
+  PBUF_TRANSPORT = 74,
+  PBUF_IP = 54,
+  PBUF_LINK = 14,
+  PBUF_RAW_TX = 0,
+  PBUF_RAW = 0
+} pbuf_layer;
+
+typedef enum {
+  PBUF_RAM,
+  PBUF_ROM,
+  PBUF_REF,
+  PBUF_POOL
+} pbuf_type;
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+  u8_t type_internal;
+  u8_t flags;
+  u8_t ref;
+  u8_t if_idx;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_ref(struct pbuf *p);
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+
+#endif  // LWIP_HDR_PBUF_H
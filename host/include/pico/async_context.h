@@ -0,0 +1,55 @@
+// Host stand-in for the Pico SDK's pico/async_context.h: the workers and
+// calls of the context cyw43_arch runs on. Under the poll arch workers run
+// from async_context_poll(); under the threadsafe_background arch from a
+// simulated core 0 interrupt as soon as they are due.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_ASYNC_CONTEXT_H
+#define _PICO_ASYNC_CONTEXT_H
+
+#include "pico/time.h"
+#include "pico/types.h"
+
+typedef struct async_context async_context_t;
+
+typedef struct async_work_on_timeout {
+  struct async_work_on_timeout *next;
+  void (*do_work)(async_context_t *context, struct async_work_on_timeout *timeout);
+  absolute_time_t next_time;
+  void *user_data;
+} async_at_time_worker_t;
+
+typedef struct async_when_pending_worker {
+  struct async_when_pending_worker *next;
+  void (*do_work)(async_context_t *context, struct async_when_pending_worker *worker);
+  bool work_pending;
+  void *user_data;
+} async_when_pending_worker_t;
+
+bool async_context_add_at_time_worker(async_context_t *context, async_at_time_worker_t *worker);
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker);
+bool async_context_add_when_pending_worker(async_context_t *context,
+                                           async_when_pending_worker_t *worker);
+bool async_context_remove_when_pending_worker(async_context_t *context,
+                                              async_when_pending_worker_t *worker);
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker);
+void async_context_poll(async_context_t *context);
+void async_context_wait_for_work_until(async_context_t *context, absolute_time_t until);
+void async_context_acquire_lock_blocking(async_context_t *context);
+void async_context_release_lock(async_context_t *context);
+
+static inline bool async_context_add_at_time_worker_at(async_context_t *context,
+                                                       async_at_time_worker_t *worker,
+                                                       absolute_time_t at) {
+  worker->next_time = at;
+  return async_context_add_at_time_worker(context, worker);
+}
+
+static inline bool async_context_add_at_time_worker_in_ms(async_context_t *context,
+                                                          async_at_time_worker_t *worker,
+                                                          uint32_t ms) {
+  return async_context_add_at_time_worker_at(context, worker, make_timeout_time_ms(ms));
+}
+
+#endif  // _PICO_ASYNC_CONTEXT_H
@@ -0,0 +1,62 @@
+// Host stand-in for the Pico SDK's pico/cyw43_arch.h, with the link status
+// of cyw43.h. Joins and link drops follow the simulated access point.
+// Like the SDK, the arch is chosen by defining PICO_CYW43_ARCH_POLL or
+// PICO_CYW43_ARCH_THREADSAFE_BACKGROUND: received packets and async
+// context work are handed over from cyw43_arch_poll() or from a simulated
+// core 0 interrupt.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_CYW43_ARCH_H
+#define _PICO_CYW43_ARCH_H
+
+#include "pico/async_context.h"
+#include "pico/time.h"
+#include "pico/types.h"
+
+#ifndef PICO_CYW43_ARCH_THREADSAFE_BACKGROUND
+#define PICO_CYW43_ARCH_THREADSAFE_BACKGROUND 0
+#endif
+#ifndef PICO_CYW43_ARCH_POLL
+#define PICO_CYW43_ARCH_POLL (!PICO_CYW43_ARCH_THREADSAFE_BACKGROUND)
+#endif
+
+#define CYW43_WL_GPIO_LED_PIN 0
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+#define CYW43_ITF_STA 0
+
+#define CYW43_LINK_DOWN (0)
+#define CYW43_LINK_JOIN (1)
+#define CYW43_LINK_NOIP (2)
+#define CYW43_LINK_UP (3)
+#define CYW43_LINK_FAIL (-1)
+#define CYW43_LINK_NONET (-2)
+#define CYW43_LINK_BADAUTH (-3)
+
+typedef struct _cyw43_t {
+  int itf_state;
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+int sim_cyw43_arch_init(bool background);
+static inline int cyw43_arch_init(void) {
+  return sim_cyw43_arch_init(PICO_CYW43_ARCH_THREADSAFE_BACKGROUND);
+}
+void cyw43_arch_deinit(void);
+async_context_t *cyw43_arch_async_context(void);
+void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+void cyw43_arch_gpio_put(uint wl_gpio, bool value);
+void cyw43_arch_poll(void);
+void cyw43_arch_wait_for_work_until(absolute_time_t until);
+
+static inline void cyw43_arch_lwip_begin(void) {
+  async_context_acquire_lock_blocking(cyw43_arch_async_context());
+}
+static inline void cyw43_arch_lwip_end(void) {
+  async_context_release_lock(cyw43_arch_async_context());
+}
+
+#endif  // _PICO_CYW43_ARCH_H
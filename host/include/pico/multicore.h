@@ -0,0 +1,16 @@
+// Host stand-in for the Pico SDK's pico/multicore.h: core 1 runs on a
+// second host thread (see host/sim.hpp). A core locked out by the other
+// stops at its next wait and stays there until the lockout ends.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_MULTICORE_H
+#define _PICO_MULTICORE_H
+
+void multicore_launch_core1(void (*entry)(void));
+
+void multicore_lockout_victim_init(void);
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#endif  // _PICO_MULTICORE_H
@@ -0,0 +1,18 @@
+// Host stand-in for the Pico SDK's pico/stdlib.h.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
+#include "pico/types.h"
+#include "pico/time.h"
+
+bool stdio_init_all();
+
+#endif  // _PICO_STDLIB_H
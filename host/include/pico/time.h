@@ -0,0 +1,67 @@
+// Host stand-in for the Pico SDK's pico/time.h. All time is virtual and
+// owned by the simulator (see host/sim.hpp): sleeping advances the clock
+// and fires due alarms instead of blocking.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_TIME_H
+#define _PICO_TIME_H
+
+#include "pico/types.h"
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+static const absolute_time_t at_the_end_of_time = INT64_MAX;
+static const absolute_time_t nil_time = 0;
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline bool is_at_the_end_of_time(absolute_time_t t) { return t == at_the_end_of_time; }
+static inline bool is_nil_time(absolute_time_t t) { return t == nil_time; }
+
+uint64_t time_us_64();
+static inline uint32_t time_us_32() { return (uint32_t)time_us_64(); }
+static inline absolute_time_t get_absolute_time() { return time_us_64(); }
+
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+  return (t + us < t || t + us > at_the_end_of_time) ? at_the_end_of_time : t + us;
+}
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+  return delayed_by_us(t, ms * 1000ull);
+}
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+  return delayed_by_us(get_absolute_time(), us);
+}
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+  return delayed_by_ms(get_absolute_time(), ms);
+}
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+  return (int64_t)(to - from);
+}
+static inline bool time_reached(absolute_time_t t) {
+  return get_absolute_time() >= t;
+}
+static inline absolute_time_t absolute_time_min(absolute_time_t a, absolute_time_t b) {
+  return a < b ? a : b;
+}
+
+void sleep_until(absolute_time_t target);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback,
+                        void *user_data, bool fire_if_past);
+static inline alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback,
+                                         void *user_data, bool fire_if_past) {
+  return add_alarm_at(make_timeout_time_us(us), callback, user_data, fire_if_past);
+}
+static inline alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback,
+                                         void *user_data, bool fire_if_past) {
+  return add_alarm_at(make_timeout_time_ms(ms), callback, user_data, fire_if_past);
+}
+bool cancel_alarm(alarm_id_t alarm_id);
+
+#endif  // _PICO_TIME_H
@@ -0,0 +1,28 @@
+// Host stand-in for the Pico SDK's pico/types.h, used by the simulator
+// build (see host/CMakeLists.txt).
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_TYPES_H
+#define _PICO_TYPES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+
+// In the SDK this is a struct in debug builds and a plain integer otherwise.
+typedef uint64_t absolute_time_t;
+
+typedef struct {
+  int16_t year;   //!< 0..4095
+  int8_t  month;  //!< 1..12, 1 is January
+  int8_t  day;    //!< 1..28,29,30,31 depending on month
+  int8_t  dotw;   //!< 0..6, 0 is Sunday
+  int8_t  hour;   //!< 0..23
+  int8_t  min;    //!< 0..59
+  int8_t  sec;    //!< 0..59
+} datetime_t;
+
+#endif  // _PICO_TYPES_H
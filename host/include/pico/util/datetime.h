@@ -0,0 +1,12 @@
+// Host stand-in for the Pico SDK's pico/util/datetime.h.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef _PICO_UTIL_DATETIME_H
+#define _PICO_UTIL_DATETIME_H
+
+#include "pico/types.h"
+
+void datetime_to_str(char *buf, uint buf_size, const datetime_t *t);
+
+#endif  // _PICO_UTIL_DATETIME_H
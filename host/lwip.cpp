@@ -0,0 +1,218 @@
+// Host stand-ins for the lwIP pbuf, UDP and DNS functions. UDP datagrams
+// sent to port 123 of a simulated server are answered like an NTP server in
+// mode 4 would, using the server's view of true UTC. Without a Wi-Fi link
+// nothing is sent, and what arrives is lost.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "lwip/dns.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "sim.hpp"
+
+namespace {
+
+constexpr u16_t ntp_port = 123;
+constexpr u16_t ntp_msg_len = 48;
+constexpr int64_t ntp_delta_s = 2208988800;  // seconds between 1900 and 1970
+constexpr int64_t server_processing_us = 20;
+
+unsigned dns_round_robin = 0;
+
+const sim::Server *find_server(const ip_addr_t *addr) {
+  for (const sim::Server &server : sim::config().servers) {
+    if (ip_addr_cmp(&server.address, addr)) {
+      return &server;
+    }
+  }
+  return nullptr;
+}
+
+int64_t one_way_delay_us(const sim::Server &server) {
+  return server.delay_us + llround(server.jitter_us * sim::random_unit());
+}
+
+void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+void put_ntp_timestamp(uint8_t *p, int64_t unix_us) {
+  int64_t ntp_us = unix_us + ntp_delta_s * 1000000;
+  int64_t seconds = ntp_us / 1000000;
+  uint64_t fraction = (static_cast<uint64_t>(ntp_us % 1000000) << 32) / 1000000;
+  put_u32(p, static_cast<uint32_t>(seconds));  // wraps into the next era in 2036
+  put_u32(p + 4, static_cast<uint32_t>(fraction));
+}
+
+void serve_ntp(struct udp_pcb *pcb, const sim::Server &server, const uint8_t *request) {
+  sim::ntp_request_sent();
+  if (sim::random_unit() < server.loss) {
+    return;
+  }
+  uint64_t arrival_us = sim::now_us() + one_way_delay_us(server);
+  uint64_t delivery_us = arrival_us + server_processing_us + one_way_delay_us(server);
+  if (sim::random_unit() < server.loss) {
+    return;
+  }
+  uint8_t reply[ntp_msg_len] = {};
+  reply[0] = 0x24;  // LI 0, version 4, mode 4 (server)
+  reply[1] = 2;     // stratum
+  reply[2] = request[2];
+  reply[3] = 0xec;  // precision 2^-20 s
+  memcpy(&reply[12], "SIM\0", 4);
+  int64_t receive_utc_us = sim::true_utc_us(arrival_us) + server.offset_us;
+  put_ntp_timestamp(&reply[16], receive_utc_us - 16000000);  // reference
+  memcpy(&reply[24], &request[40], 8);                        // origin
+  put_ntp_timestamp(&reply[32], receive_utc_us);              // receive
+  put_ntp_timestamp(&reply[40], receive_utc_us + server_processing_us);  // transmit
+
+  ip_addr_t from = server.address;
+  std::string payload(reinterpret_cast<const char *>(reply), sizeof(reply));
+  sim::add_net_work(delivery_us, [pcb, from, payload] {
+    if (!sim::wifi_link_up()) {
+      return;
+    }
+    sim::ntp_reply_sent();
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, ntp_msg_len, PBUF_RAM);
+    memcpy(p->payload, payload.data(), ntp_msg_len);
+    if (pcb->recv) {
+      pcb->recv(pcb->recv_arg, pcb, p, &from, ntp_port);
+    } else {
+      pbuf_free(p);
+    }
+  });
+}
+
+}  // namespace
+
+char *ipaddr_ntoa(const ip_addr_t *addr) {
+  static char buf[16];
+  uint32_t a = ip4_addr_get_u32(addr);
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a & 0xff, (a >> 8) & 0xff,
+           (a >> 16) & 0xff, a >> 24);
+  return buf;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+  // Payload follows the header in the same allocation, like PBUF_RAM. The
+  // caller points the payload of PBUF_ROM and PBUF_REF pbufs at its data.
+  bool by_reference = type == PBUF_ROM || type == PBUF_REF;
+  size_t size = sizeof(struct pbuf) + (by_reference ? 0 : length);
+  struct pbuf *p = static_cast<struct pbuf *>(calloc(1, size));
+  if (!p) {
+    return nullptr;
+  }
+  p->payload = by_reference ? nullptr : p + 1;
+  p->tot_len = length;
+  p->len = length;
+  p->type_internal = type;
+  p->ref = 1;
+  return p;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+  u8_t count = 0;
+  while (p && --p->ref == 0) {
+    struct pbuf *next = p->next;
+    free(p);
+    p = next;
+    count++;
+  }
+  return count;
+}
+
+void pbuf_ref(struct pbuf *p) {
+  p->ref++;
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset) {
+  for (; p; p = p->next) {
+    if (offset < p->len) {
+      return static_cast<const u8_t *>(p->payload)[offset];
+    }
+    offset -= p->len;
+  }
+  return 0;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset) {
+  u16_t copied = 0;
+  for (; p && copied < len; p = p->next) {
+    if (offset >= p->len) {
+      offset -= p->len;
+      continue;
+    }
+    u16_t n = p->len - offset;
+    if (n > len - copied) {
+      n = len - copied;
+    }
+    memcpy(static_cast<u8_t *>(dataptr) + copied,
+           static_cast<const u8_t *>(p->payload) + offset, n);
+    copied += n;
+    offset = 0;
+  }
+  return copied;
+}
+
+struct udp_pcb *udp_new_ip_type(u8_t type) {
+  return static_cast<struct udp_pcb *>(calloc(1, sizeof(struct udp_pcb)));
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+  free(pcb);
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg) {
+  pcb->recv = recv;
+  pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip,
+                 u16_t dst_port) {
+  const sim::Server *server = find_server(dst_ip);
+  if (!server || dst_port != ntp_port || !sim::wifi_link_up()) {
+    return ERR_RTE;
+  }
+  uint8_t request[ntp_msg_len] = {};
+  if (p->tot_len >= ntp_msg_len) {
+    pbuf_copy_partial(p, request, ntp_msg_len, 0);
+    serve_ntp(pcb, *server, request);
+  }
+  return ERR_OK;
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg) {
+  const std::vector<sim::Server> &servers = sim::config().servers;
+  if (!hostname || servers.empty()) {
+    return ERR_ARG;
+  }
+  // "<n>.pool.ntp.org" picks server n, other names rotate through all.
+  char *end;
+  unsigned long n = strtoul(hostname, &end, 10);
+  const sim::Server *server = nullptr;
+  if (end != hostname && *end == '.') {
+    server = &servers[n % servers.size()];
+  } else if (strstr(hostname, "ntp.org")) {
+    server = &servers[dns_round_robin++ % servers.size()];
+  }
+  sim::dns_lookup();
+  std::string name(hostname);
+  ip_addr_t resolved = server ? server->address : ip_addr_t{};
+  bool ok = server != nullptr && sim::random_unit() >= sim::config().dns_failure &&
+            sim::wifi_link_up();
+  sim::add_net_work(sim::now_us() + sim::config().dns_delay_us,
+                    [name, resolved, ok, found, callback_arg] {
+    found(name.c_str(), ok && sim::wifi_link_up() ? &resolved : nullptr, callback_arg);
+  });
+  return ERR_INPROGRESS;
+}
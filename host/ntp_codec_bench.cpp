@@ -0,0 +1,129 @@
+// Host benchmark for the NTP packet codec: decodes a server reply the way
+// ntp_recv() used to, byte by byte through pbuf accessors, and through
+// NtpPacketView in place, and builds requests both ways.
+//
+// Costs are host nanoseconds and only meaningful relative to each other.
+// The pbufs come from the host stand-in, where pbuf_alloc() is calloc()
+// rather than an lwIP memory pool.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "lwip/pbuf.h"
+#include "ntp_packet.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+constexpr uint64_t origin = 0xe8f5a1b2c3d4e5f6ull;
+
+volatile int64_t sink;
+
+struct pbuf *make_reply() {
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NtpPacketView::size, PBUF_RAM);
+  uint8_t *reply = static_cast<uint8_t *>(p->payload);
+  memset(reply, 0, NtpPacketView::size);
+  reply[0] = 0x24;  // LI 0, version 4, mode 4 (server)
+  reply[1] = 2;
+  uint64_t timestamps[4] = {origin - 16, origin, origin + 1000, origin + 2000};
+  for (int field = 0; field < 4; field++) {
+    for (int i = 0; i < 8; i++) {
+      reply[16 + field * 8 + i] = static_cast<uint8_t>(timestamps[field] >> (56 - 8 * i));
+    }
+  }
+  return p;
+}
+
+uint64_t read_timestamp(struct pbuf *p, u16_t offset) {
+  uint8_t buf[8] = {0};
+  pbuf_copy_partial(p, buf, sizeof(buf), offset);
+  uint64_t timestamp = 0;
+  for (int i = 0; i < 8; i++) {
+    timestamp = timestamp << 8 | buf[i];
+  }
+  return timestamp;
+}
+
+int64_t decode_copying(struct pbuf *p) {
+  uint8_t mode = pbuf_get_at(p, 0) & 0x7;
+  uint8_t stratum = pbuf_get_at(p, 1);
+  if (p->tot_len == NtpPacketView::size && mode == 0x4 && stratum != 0 &&
+      read_timestamp(p, 24) == origin) {
+    return ntp_to_unix_us(read_timestamp(p, 32)) + ntp_to_unix_us(read_timestamp(p, 40));
+  }
+  return 0;
+}
+
+int64_t decode_in_place(struct pbuf *p) {
+  const uint8_t *data = static_cast<const uint8_t *>(p->payload);
+  if (ntp_check_reply(data, p->tot_len, origin) == NtpReply::ok) {
+    NtpPacketView packet(data);
+    return ntp_to_unix_us(packet.receive_timestamp()) +
+           ntp_to_unix_us(packet.transmit_timestamp());
+  }
+  return 0;
+}
+
+int64_t request_allocated(uint64_t timestamp) {
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NtpPacketView::size, PBUF_RAM);
+  uint8_t *req = static_cast<uint8_t *>(p->payload);
+  memset(req, 0, NtpPacketView::size);
+  req[0] = 0x1b;
+  ntp_set_transmit_timestamp(req, timestamp);
+  int64_t result = req[47];
+  pbuf_free(p);
+  return result;
+}
+
+uint8_t prepared[NtpPacketView::size];
+
+int64_t request_lent(uint64_t timestamp) {
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NtpPacketView::size, PBUF_REF);
+  p->payload = prepared;
+  ntp_set_transmit_timestamp(prepared, timestamp);
+  int64_t result = static_cast<uint8_t *>(p->payload)[47];
+  pbuf_free(p);
+  return result;
+}
+
+template <typename F>
+double ns_per_call(uint64_t iterations, F f) {
+  bench_clock::time_point start = bench_clock::now();
+  int64_t sum = 0;
+  for (uint64_t i = 0; i < iterations; i++) {
+    sum += f(i);
+  }
+  sink = sum;
+  std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint64_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+  struct pbuf *reply = make_reply();
+  ntp_prepare_request(prepared);
+  if (decode_copying(reply) != decode_in_place(reply)) {
+    fprintf(stderr, "ntp_codec_bench: decoders disagree\n");
+    return 1;
+  }
+
+  printf("ntp_codec_bench: %" PRIu64 " iterations\n", iterations);
+  printf("  decode, pbuf_copy_partial:     %6.1f ns\n",
+         ns_per_call(iterations, [reply](uint64_t) { return decode_copying(reply); }));
+  printf("  decode, NtpPacketView:         %6.1f ns\n",
+         ns_per_call(iterations, [reply](uint64_t) { return decode_in_place(reply); }));
+  printf("  request, pbuf_alloc + memset:  %6.1f ns\n",
+         ns_per_call(iterations, [](uint64_t i) { return request_allocated(origin + i); }));
+  printf("  request, prepared + PBUF_REF:  %6.1f ns\n",
+         ns_per_call(iterations, [](uint64_t i) { return request_lent(origin + i); }));
+  pbuf_free(reply);
+  return 0;
+}
@@ -0,0 +1,100 @@
+// Host stand-in for the parts of pimoroni-pico's PicoGraphics the clock
+// uses.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <algorithm>
+#include <cmath>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+namespace pimoroni {
+
+  Rect Rect::intersection(const Rect &r) const {
+    int32_t x0 = std::max(x, r.x);
+    int32_t y0 = std::max(y, r.y);
+    int32_t x1 = std::min(x + w, r.x + r.w);
+    int32_t y1 = std::min(y + h, r.y + r.h);
+    return Rect(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+  }
+
+  void PicoGraphics::clear() {
+    rectangle(clip);
+  }
+
+  void PicoGraphics::pixel(const Point &p) {
+    if (clip.contains(p)) {
+      set_pixel(p);
+    }
+  }
+
+  void PicoGraphics::pixel_span(const Point &p, int32_t l) {
+    Rect span = Rect(p.x, p.y, l, 1).intersection(clip);
+    if (!span.empty()) {
+      set_pixel_span(Point(span.x, span.y), span.w);
+    }
+  }
+
+  void PicoGraphics::rectangle(const Rect &r) {
+    Rect area = r.intersection(clip);
+    for (int32_t y = area.y; y < area.y + area.h; y++) {
+      set_pixel_span(Point(area.x, y), area.w);
+    }
+  }
+
+  void PicoGraphics::text(const std::string_view &t, const Point &p, int32_t wrap,
+                          float s, float a, uint8_t letter_spacing, bool fixed_width) {
+    // Placeholder glyphs: a bit pattern derived from the character code in a
+    // cell the size of a bitmap8 glyph at the given scale.
+    int32_t glyph_width = std::max(1, static_cast<int>(std::lround(6 * s)));
+    int32_t glyph_height = std::max(1, static_cast<int>(std::lround(8 * s)));
+    int32_t x = p.x;
+    for (char c : t) {
+      if (c == '\n') {
+        break;
+      }
+      if (c != ' ') {
+        for (int32_t gy = 0; gy < glyph_height; gy++) {
+          for (int32_t gx = 0; gx < glyph_width; gx++) {
+            if ((c >> ((gx + gy) % 7)) & 1) {
+              pixel(Point(x + gx, p.y + gy));
+            }
+          }
+        }
+      }
+      x += glyph_width + letter_spacing;
+    }
+  }
+
+  PicoGraphics_PenRGB888::PicoGraphics_PenRGB888(uint16_t width, uint16_t height,
+                                                 void *frame_buffer)
+    : PicoGraphics(width, height, frame_buffer) {
+    this->pen_type = PEN_RGB888;
+    if (this->frame_buffer == nullptr) {
+      this->frame_buffer = new uint8_t[buffer_size(width, height)]();
+    }
+  }
+
+  void PicoGraphics_PenRGB888::set_pen(uint c) {
+    color = RGB888{uint8_t(c >> 16), uint8_t(c >> 8), uint8_t(c)};
+  }
+
+  void PicoGraphics_PenRGB888::set_pen(uint8_t r, uint8_t g, uint8_t b) {
+    color = RGB888{r, g, b};
+  }
+
+  int PicoGraphics_PenRGB888::create_pen(uint8_t r, uint8_t g, uint8_t b) {
+    return (r << 16) | (g << 8) | b;
+  }
+
+  void PicoGraphics_PenRGB888::set_pixel(const Point &p) {
+    uint32_t *buf = static_cast<uint32_t *>(frame_buffer);
+    buf[p.y * bounds.w + p.x] = (color.r << 16) | (color.g << 8) | color.b;
+  }
+
+  void PicoGraphics_PenRGB888::set_pixel_span(const Point &p, uint l) {
+    uint32_t *buf = static_cast<uint32_t *>(frame_buffer) + p.y * bounds.w + p.x;
+    std::fill(buf, buf + l, (color.r << 16) | (color.g << 8) | color.b);
+  }
+
+}
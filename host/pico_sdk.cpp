@@ -0,0 +1,485 @@
+// Host stand-ins for the Pico SDK time, alarm, RTC, stdio, GPIO, multicore,
+// flash, async_context and cyw43_arch functions, all driven by the
+// simulator's virtual clock.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+
+#include "hardware/flash.h"
+#include "pico/async_context.h"
+#include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "pico/cyw43_arch.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "pico/util/datetime.h"
+#include "sim.hpp"
+
+// Context of cyw43_arch_async_context(), the only one there is
+struct async_context {
+  bool background;                              //!< work runs from a core 0 interrupt
+  async_at_time_worker_t *at_time_workers;
+  async_when_pending_worker_t *when_pending_workers;
+  int lock_depth;
+  bool executing;
+  uint32_t irq;                                 //!< armed for the next work, background only
+  uint64_t irq_at_us;
+};
+
+namespace {
+
+struct Alarm {
+  uint32_t         timer;      //!< simulator timer currently armed for this alarm
+  absolute_time_t  target;
+  alarm_callback_t callback;
+  void            *user_data;
+};
+
+std::map<alarm_id_t, Alarm> alarms;
+alarm_id_t next_alarm_id = 1;
+
+bool rtc_is_running = false;
+int64_t rtc_epoch_s;     //!< RTC value at the time it was loaded
+uint64_t rtc_load_us;    //!< device time at which the RTC was loaded
+datetime_t rtc_alarm;
+rtc_callback_t rtc_alarm_callback;
+bool rtc_alarm_enabled = false;
+uint32_t rtc_alarm_timer = 0;
+
+void arm_alarm(alarm_id_t id);
+void arm_async_context(async_context_t *context);
+
+bool work_pending(const async_context_t *context) {
+  for (const async_when_pending_worker_t *w = context->when_pending_workers; w; w = w->next) {
+    if (w->work_pending) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Earliest at-time worker, or nullptr
+async_at_time_worker_t *next_at_time_worker(const async_context_t *context) {
+  async_at_time_worker_t *next = nullptr;
+  for (async_at_time_worker_t *w = context->at_time_workers; w; w = w->next) {
+    if (!next || w->next_time < next->next_time) {
+      next = w;
+    }
+  }
+  return next;
+}
+
+// Runs pending workers and due at-time workers until there are none.
+void execute_async_context(async_context_t *context) {
+  context->executing = true;
+  context->lock_depth++;
+  bool ran = true;
+  while (ran) {
+    ran = false;
+    for (async_when_pending_worker_t *w = context->when_pending_workers; w; w = w->next) {
+      if (w->work_pending) {
+        w->work_pending = false;
+        w->do_work(context, w);
+        ran = true;
+      }
+    }
+    async_at_time_worker_t *next = next_at_time_worker(context);
+    if (next && time_reached(next->next_time)) {
+      async_context_remove_at_time_worker(context, next);
+      next->do_work(context, next);
+      ran = true;
+    }
+  }
+  context->lock_depth--;
+  context->executing = false;
+  arm_async_context(context);
+}
+
+// Under the background arch, arms the core 0 interrupt for the next work.
+// Work becoming due while the lock is held waits for its release.
+void arm_async_context(async_context_t *context) {
+  if (!context->background || context->executing || context->lock_depth > 0) {
+    return;
+  }
+  async_at_time_worker_t *next = next_at_time_worker(context);
+  uint64_t at_us = work_pending(context) ? sim::now_us()
+                                         : (next ? next->next_time : UINT64_MAX);
+  if (context->irq != 0 && context->irq_at_us == at_us) {
+    return;
+  }
+  if (context->irq != 0) {
+    sim::cancel_core0_irq(context->irq);
+    context->irq = 0;
+  }
+  if (at_us != UINT64_MAX) {
+    context->irq_at_us = at_us;
+    context->irq = sim::add_core0_irq(at_us, [context] {
+      context->irq = 0;
+      if (context->lock_depth > 0) {
+        return;  // taken again when the lock is released
+      }
+      execute_async_context(context);
+    });
+  }
+}
+
+void fire_alarm(alarm_id_t id) {
+  auto it = alarms.find(id);
+  if (it == alarms.end()) {
+    return;
+  }
+  Alarm &alarm = it->second;
+  int64_t reschedule = alarm.callback(id, alarm.user_data);
+  it = alarms.find(id);  // the callback may have cancelled the alarm
+  if (it == alarms.end()) {
+    return;
+  }
+  if (reschedule == 0) {
+    alarms.erase(it);
+    return;
+  }
+  // < 0: relative to the previous target, > 0: relative to now
+  it->second.target = (reschedule < 0) ? it->second.target - reschedule
+                                       : sim::now_us() + reschedule;
+  arm_alarm(id);
+}
+
+void arm_alarm(alarm_id_t id) {
+  alarms[id].timer = sim::add_timer(alarms[id].target, [id] { fire_alarm(id); });
+}
+
+void to_datetime(int64_t epoch_s, datetime_t *t) {
+  time_t epoch = epoch_s;
+  struct tm tm;
+  gmtime_r(&epoch, &tm);
+  t->year = static_cast<int16_t>(tm.tm_year + 1900);
+  t->month = static_cast<int8_t>(tm.tm_mon + 1);
+  t->day = static_cast<int8_t>(tm.tm_mday);
+  t->dotw = static_cast<int8_t>(tm.tm_wday);
+  t->hour = static_cast<int8_t>(tm.tm_hour);
+  t->min = static_cast<int8_t>(tm.tm_min);
+  t->sec = static_cast<int8_t>(tm.tm_sec);
+}
+
+bool alarm_matches(const datetime_t &t) {
+  const datetime_t &a = rtc_alarm;
+  return (a.year < 0 || a.year == t.year) && (a.month < 0 || a.month == t.month) &&
+         (a.day < 0 || a.day == t.day) && (a.dotw < 0 || a.dotw == t.dotw) &&
+         (a.hour < 0 || a.hour == t.hour) && (a.min < 0 || a.min == t.min) &&
+         (a.sec < 0 || a.sec == t.sec);
+}
+
+bool alarm_repeats() {
+  const datetime_t &a = rtc_alarm;
+  return a.year < 0 || a.month < 0 || a.day < 0 || a.dotw < 0 || a.hour < 0 ||
+         a.min < 0 || a.sec < 0;
+}
+
+// Arms a simulator timer for the next RTC second that matches the alarm,
+// searching up to a day ahead.
+void arm_rtc_alarm() {
+  sim::cancel_timer(rtc_alarm_timer);
+  rtc_alarm_timer = 0;
+  if (!rtc_alarm_enabled || !rtc_is_running) {
+    return;
+  }
+  int64_t elapsed_s = (sim::now_us() - rtc_load_us) / 1000000;
+  for (int64_t s = elapsed_s + 1; s <= elapsed_s + 86400; s++) {
+    datetime_t t;
+    to_datetime(rtc_epoch_s + s, &t);
+    if (alarm_matches(t)) {
+      rtc_alarm_timer = sim::add_timer(rtc_load_us + s * 1000000, [] {
+        // Like the SDK's IRQ handler: disable, call back, re-enable if repeating.
+        rtc_alarm_timer = 0;
+        rtc_alarm_enabled = false;
+        rtc_alarm_callback();
+        if (!rtc_alarm_enabled && alarm_repeats()) {
+          rtc_enable_alarm();
+        }
+      });
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+bool stdio_init_all() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  // newlib on the device has no timezone database; keep localtime() on UTC.
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  sim::config();
+  return true;
+}
+
+uint64_t time_us_64() {
+  return sim::now_us();
+}
+
+void busy_wait_us(uint64_t delay_us) {
+  sim::busy_wait(delay_us);
+}
+
+void sleep_until(absolute_time_t target) {
+  sim::idle_until(target, false);
+}
+
+void sleep_us(uint64_t us) {
+  sleep_until(make_timeout_time_us(us));
+}
+
+void sleep_ms(uint32_t ms) {
+  sleep_until(make_timeout_time_ms(ms));
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+  sim::idle_until(timeout_timestamp, true);
+  return time_reached(timeout_timestamp);
+}
+
+void __sev(void) {
+  sim::send_event();
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+  sim::launch_core1(entry);
+}
+
+void multicore_lockout_victim_init(void) {}
+
+void multicore_lockout_start_blocking(void) {
+  sim::lockout_other_core(true);
+}
+
+void multicore_lockout_end_blocking(void) {
+  sim::lockout_other_core(false);
+}
+
+uintptr_t sim_flash_base(void) {
+  return reinterpret_cast<uintptr_t>(sim::flash());
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  sim::flash_erase(flash_offs, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+  sim::flash_program(flash_offs, data, count);
+}
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback,
+                        void *user_data, bool fire_if_past) {
+  if (time <= sim::now_us()) {
+    if (!fire_if_past) {
+      return 0;
+    }
+    time = sim::now_us();
+  }
+  alarm_id_t id = next_alarm_id++;
+  alarms[id] = Alarm{0, time, callback, user_data};
+  arm_alarm(id);
+  return id;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+  auto it = alarms.find(alarm_id);
+  if (it == alarms.end()) {
+    return false;
+  }
+  sim::cancel_timer(it->second.timer);
+  alarms.erase(it);
+  return true;
+}
+
+void rtc_init(void) {
+  rtc_is_running = false;
+}
+
+bool rtc_set_datetime(datetime_t *t) {
+  struct tm tm = {};
+  tm.tm_year = t->year - 1900;
+  tm.tm_mon = t->month - 1;
+  tm.tm_mday = t->day;
+  tm.tm_hour = t->hour;
+  tm.tm_min = t->min;
+  tm.tm_sec = t->sec;
+  rtc_epoch_s = timegm(&tm);
+  rtc_load_us = sim::now_us();
+  rtc_is_running = true;
+  sim::rtc_loaded(rtc_epoch_s);
+  arm_rtc_alarm();
+  return true;
+}
+
+bool rtc_get_datetime(datetime_t *t) {
+  if (!rtc_is_running) {
+    return false;
+  }
+  to_datetime(rtc_epoch_s + (sim::now_us() - rtc_load_us) / 1000000, t);
+  return true;
+}
+
+bool rtc_running(void) {
+  return rtc_is_running;
+}
+
+void rtc_set_alarm(datetime_t *t, rtc_callback_t user_callback) {
+  rtc_disable_alarm();
+  rtc_alarm = *t;
+  rtc_alarm_callback = user_callback;
+  rtc_enable_alarm();
+}
+
+void rtc_enable_alarm(void) {
+  rtc_alarm_enabled = true;
+  arm_rtc_alarm();
+}
+
+void rtc_disable_alarm(void) {
+  rtc_alarm_enabled = false;
+  arm_rtc_alarm();
+}
+
+void datetime_to_str(char *buf, uint buf_size, const datetime_t *t) {
+  snprintf(buf, buf_size, "%04d-%02d-%02d %02d:%02d:%02d", t->year, t->month,
+           t->day, t->hour, t->min, t->sec);
+}
+
+bool gpio_get(uint gpio) {
+  return true;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+}
+
+async_context_t cyw43_context;
+
+int sim_cyw43_arch_init(bool background) {
+  cyw43_context.background = background;
+  sim::set_net_work_irq(background);
+  return 0;
+}
+
+async_context_t *cyw43_arch_async_context(void) {
+  return &cyw43_context;
+}
+
+void cyw43_arch_deinit(void) {
+}
+
+void cyw43_arch_enable_sta_mode(void) {
+}
+
+cyw43_t cyw43_state;
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth) {
+  sim::wifi_join();
+  return 0;
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf) {
+  return sim::wifi_link_status();
+}
+
+bool async_context_add_at_time_worker(async_context_t *context, async_at_time_worker_t *worker) {
+  for (async_at_time_worker_t *w = context->at_time_workers; w; w = w->next) {
+    if (w == worker) {
+      return false;
+    }
+  }
+  worker->next = context->at_time_workers;
+  context->at_time_workers = worker;
+  arm_async_context(context);
+  return true;
+}
+
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker) {
+  for (async_at_time_worker_t **w = &context->at_time_workers; *w; w = &(*w)->next) {
+    if (*w == worker) {
+      *w = worker->next;
+      worker->next = nullptr;
+      arm_async_context(context);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool async_context_add_when_pending_worker(async_context_t *context,
+                                           async_when_pending_worker_t *worker) {
+  for (async_when_pending_worker_t *w = context->when_pending_workers; w; w = w->next) {
+    if (w == worker) {
+      return false;
+    }
+  }
+  worker->next = context->when_pending_workers;
+  context->when_pending_workers = worker;
+  arm_async_context(context);
+  return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t *context,
+                                              async_when_pending_worker_t *worker) {
+  for (async_when_pending_worker_t **w = &context->when_pending_workers; *w; w = &(*w)->next) {
+    if (*w == worker) {
+      *w = worker->next;
+      worker->next = nullptr;
+      return true;
+    }
+  }
+  return false;
+}
+
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker) {
+  worker->work_pending = true;
+  arm_async_context(context);
+}
+
+void async_context_poll(async_context_t *context) {
+  if (!context->background) {
+    execute_async_context(context);
+  }
+}
+
+void async_context_wait_for_work_until(async_context_t *context, absolute_time_t until) {
+  if (context->background) {
+    sleep_until(until);
+    return;
+  }
+  if (work_pending(context)) {
+    return;
+  }
+  async_at_time_worker_t *next = next_at_time_worker(context);
+  sim::idle_until(next ? absolute_time_min(until, next->next_time) : until, true);
+}
+
+void async_context_acquire_lock_blocking(async_context_t *context) {
+  context->lock_depth++;
+}
+
+void async_context_release_lock(async_context_t *context) {
+  if (--context->lock_depth == 0) {
+    arm_async_context(context);
+  }
+}
+
+void cyw43_arch_gpio_put(uint wl_gpio, bool value) {
+}
+
+void cyw43_arch_poll(void) {
+  sim::run_net_work();
+  async_context_poll(&cyw43_context);
+}
+
+void cyw43_arch_wait_for_work_until(absolute_time_t until) {
+  async_context_wait_for_work_until(&cyw43_context, until);
+}
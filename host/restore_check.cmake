@@ -0,0 +1,52 @@
+# Script of the ntp_rtc_restore_check target: runs a simulator twice on
+# one flash image, the second time an hour later, so that it boots from a
+# journal whose time is an hour old. The kept time has to be shown right
+# away, and the first NTP reply of the startup burst has to step it, well
+# before the burst is over.
+#
+#   cmake -DSIM=<simulator> -DFLASH=<flash image> -P restore_check.cmake
+
+set(start 1700000000)
+set(max_confirmed_ms 2500)  # Wi-Fi is up at 1.5 s, the burst ends after 7 s
+
+get_filename_component(name ${SIM} NAME)
+file(REMOVE ${FLASH})
+execute_process(COMMAND ${CMAKE_COMMAND} -E env
+                        NTP_RTC_SIM_SECONDS=30 NTP_RTC_SIM_START=${start}
+                        NTP_RTC_SIM_FLASH=${FLASH} ${SIM}
+        OUTPUT_QUIET
+        RESULT_VARIABLE result
+        )
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${name}: first run failed")
+endif()
+
+math(EXPR later "${start} + 3600")
+execute_process(COMMAND ${CMAKE_COMMAND} -E env
+                        NTP_RTC_SIM_SECONDS=20 NTP_RTC_SIM_START=${later}
+                        NTP_RTC_SIM_FLASH=${FLASH} ${SIM}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+        )
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${name}: second run failed")
+endif()
+
+if(NOT output MATCHES "journal: restored time")
+  message(FATAL_ERROR "${name}: the journal of the first run was not restored")
+endif()
+if(NOT output MATCHES "kept time shown ([0-9]+) ms")
+  message(FATAL_ERROR "${name}: the kept time was not shown")
+endif()
+set(kept_ms ${CMAKE_MATCH_1})
+if(NOT output MATCHES "step \\+35[0-9][0-9][0-9]+ us")
+  message(FATAL_ERROR "${name}: the hour-old time was not stepped")
+endif()
+if(NOT output MATCHES "\ntime shown ([0-9]+) ms")
+  message(FATAL_ERROR "${name}: no NTP-confirmed time was shown")
+endif()
+set(confirmed_ms ${CMAKE_MATCH_1})
+if(confirmed_ms GREATER max_confirmed_ms)
+  message(FATAL_ERROR "${name}: time confirmed only ${confirmed_ms} ms after power-on")
+endif()
+message(STATUS "${name}: kept time shown at ${kept_ms} ms, confirmed at ${confirmed_ms} ms")
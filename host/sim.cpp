@@ -0,0 +1,778 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include "sim.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "hardware/flash.h"
+#include "pico/cyw43_arch.h"
+
+namespace sim {
+
+namespace {
+
+using host_clock = std::chrono::steady_clock;
+
+struct Timer {
+  uint32_t id;
+  Work     work;
+};
+
+// One core of the device, i.e. one host thread running firmware code.
+struct Core {
+  bool     launched = false;
+  bool     waiting = false;       //!< in idle_until() or busy_wait() until released
+  uint64_t until_us = 0;          //!< release time of the current wait
+  bool     wake_on_event = false; //!< interrupts and events also release the wait
+  bool     event = false;         //!< latched event, like the one WFE consumes
+  bool     held = false;          //!< locked out by the other core
+  host_clock::time_point busy_since = host_clock::now();
+  uint64_t passes = 0;            //!< number of times the core went idle or took an interrupt
+  int64_t  busy_ns = 0;           //!< host time spent outside of idle
+  int64_t  max_busy_ns = 0;       //!< longest single busy stretch
+};
+
+struct Stats {
+  uint64_t frames = 0;            //!< frames pushed to the panel
+  uint64_t pixels = 0;            //!< pixel colours converted by the panel driver
+  uint64_t ntp_requests = 0;
+  uint64_t ntp_replies = 0;
+  uint64_t dns_lookups = 0;
+  uint64_t rtc_loads = 0;
+  int64_t  first_rtc_load_us = -1;
+  int64_t  rtc_epoch_s = 0;       //!< RTC value at the last load
+  uint64_t rtc_load_us = 0;       //!< device time of the last load
+  int      brightness = -1;       //!< panel brightness in 1/256, -1 before it is set
+  uint64_t brightness_since_us = 0;
+  double   brightness_integral = 0.0;  //!< brightness times seconds, up to brightness_since_us
+  int      brightness_min = 256;
+  int      brightness_max = 0;
+  uint64_t brightness_changes = 0;
+  uint64_t flips = 0;             //!< frame changes after at least 500 ms of stillness
+  double   flip_phase_sum = 0.0;
+  double   flip_phase_min = 0.5;
+  double   flip_phase_max = -0.5;
+  uint64_t flash_erases = 0;      //!< sectors erased
+  uint64_t flash_programs = 0;    //!< pages programmed
+  uint64_t lockouts = 0;
+  uint64_t lockout_since_us = 0;
+  uint64_t max_lockout_us = 0;
+  uint64_t held_up_waits = 0;     //!< waits of a locked-out core that ended late
+  uint64_t wifi_joins = 0;
+  uint64_t wifi_failed_joins = 0;
+  uint64_t wifi_drops = 0;        //!< associations an outage ended
+  int64_t  first_wifi_up_us = -1;
+  uint64_t wifi_up_us = 0;        //!< time associated, up to wifi_up_since_us
+};
+
+enum class WifiState { down, joining, up, failed };
+
+// Typical times of the Pico W's W25Q16JV flash chip
+constexpr uint64_t flash_erase_us = 45000;   //!< per 4 KB sector
+constexpr uint64_t flash_program_us = 400;   //!< per 256 B page
+
+// The cores run concurrently, but virtual time only moves on while all of
+// them wait. Everything below is guarded by `lock`; `now` can be read
+// without it.
+std::recursive_mutex lock;
+std::condition_variable_any released;
+Config cfg;
+bool cfg_loaded = false;
+std::atomic<uint64_t> now{0};
+std::mt19937 rng;
+std::multimap<uint64_t, Timer> timers;
+std::multimap<uint64_t, Work> net_work;
+std::multimap<uint64_t, Timer> core0_irqs;
+bool core0_in_irq = false;
+bool net_work_irq = false;
+uint32_t next_timer_id = 1;
+Stats stats;
+Core cores[2] = {Core{true}, Core{}};
+thread_local int this_core = 0;
+const uint8_t *changed_panel = nullptr;  //!< panel changed since the last wait
+int changed_width = 0;
+int changed_height = 0;
+std::vector<uint8_t> last_frame;  //!< lit pixels of the last frame
+std::vector<uint8_t> flash_image;
+WifiState wifi_state = WifiState::down;
+uint64_t wifi_join_done_us = 0;  //!< when the current join completes or fails
+uint64_t wifi_up_since_us = 0;
+uint64_t last_frame_change_us = 0;
+
+double env_double(const char *name, double fallback) {
+  const char *value = getenv(name);
+  return value ? strtod(value, nullptr) : fallback;
+}
+
+std::vector<Outage> parse_outages(const char *spec) {
+  std::vector<Outage> outages;
+  while (spec && *spec) {
+    double from_s = 0, seconds = 0;
+    if (sscanf(spec, "%lf:%lf", &from_s, &seconds) != 2) {
+      fprintf(stderr, "sim: bad outage spec '%s'\n", spec);
+      exit(2);
+    }
+    uint64_t from_us = llround(from_s * 1e6);
+    outages.push_back(Outage{from_us, from_us + llround(seconds * 1e6)});
+    spec = strchr(spec, ',');
+    if (spec) {
+      spec++;
+    }
+  }
+  std::sort(outages.begin(), outages.end(),
+            [](const Outage &a, const Outage &b) { return a.from_us < b.from_us; });
+  return outages;
+}
+
+std::vector<Server> parse_servers(const char *spec) {
+  std::vector<Server> servers;
+  while (spec && *spec) {
+    double offset_ms = 0, delay_ms = 0, jitter_ms = 0, loss = 0;
+    if (sscanf(spec, "%lf:%lf:%lf:%lf", &offset_ms, &delay_ms, &jitter_ms, &loss) < 2) {
+      fprintf(stderr, "sim: bad server spec '%s'\n", spec);
+      exit(2);
+    }
+    Server server;
+    uint32_t host = static_cast<uint32_t>(servers.size() + 1);
+    ip4_addr_set_u32(&server.address, 10u | host << 24);  // 10.0.0.<n>
+    server.offset_us = llround(offset_ms * 1000);
+    server.delay_us = llround(delay_ms * 1000);
+    server.jitter_us = llround(jitter_ms * 1000);
+    server.loss = loss;
+    servers.push_back(server);
+    spec = strchr(spec, ',');
+    if (spec) {
+      spec++;
+    }
+  }
+  return servers;
+}
+
+void load_config() {
+  cfg.duration_us = llround(env_double("NTP_RTC_SIM_SECONDS", 120) * 1e6);
+  cfg.start_utc_us = llround(env_double("NTP_RTC_SIM_START", 1700000000.25) * 1e6);
+  cfg.drift_ppm = env_double("NTP_RTC_SIM_DRIFT_PPM", 0);
+  const char *servers = getenv("NTP_RTC_SIM_SERVERS");
+  cfg.servers = parse_servers(servers ? servers : "0:12:3:0");
+  cfg.dns_delay_us = llround(env_double("NTP_RTC_SIM_DNS_MS", 20) * 1000);
+  cfg.dns_failure = env_double("NTP_RTC_SIM_DNS_FAIL", 0);
+  cfg.net_work_us = llround(env_double("NTP_RTC_SIM_NET_WORK_US", 0));
+  cfg.wifi_delay_us = llround(env_double("NTP_RTC_SIM_WIFI_MS", 1500) * 1000);
+  cfg.wifi_outages = parse_outages(getenv("NTP_RTC_SIM_WIFI_DOWN"));
+  cfg.light_start = cfg.light_end = 2000;
+  const char *light = getenv("NTP_RTC_SIM_LIGHT");
+  if (light && sscanf(light, "%lf:%lf", &cfg.light_start, &cfg.light_end) == 1) {
+    cfg.light_end = cfg.light_start;
+  }
+  const char *ppm_dir = getenv("NTP_RTC_SIM_PPM_DIR");
+  cfg.ppm_dir = ppm_dir ? ppm_dir : "";
+  const char *flash_path = getenv("NTP_RTC_SIM_FLASH");
+  cfg.flash_path = flash_path ? flash_path : "";
+  cfg.seed = static_cast<uint32_t>(env_double("NTP_RTC_SIM_SEED", 1));
+  rng.seed(cfg.seed);
+  cfg_loaded = true;
+}
+
+// Maps a clock offset in seconds into (-450, 450], so that whole
+// quarter-hour timezone offsets do not count as errors.
+double wrap_quarter_hour(double offset_s) {
+  double wrapped = fmod(offset_s, 900.0);
+  if (wrapped > 450.0) {
+    wrapped -= 900.0;
+  } else if (wrapped <= -450.0) {
+    wrapped += 900.0;
+  }
+  return wrapped;
+}
+
+void write_ppm(const uint8_t *rgb, int width, int height) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/frame_%06" PRIu64 ".ppm", cfg.ppm_dir.c_str(),
+           stats.frames);
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "sim: cannot write %s\n", path);
+    return;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", width, height);
+  fwrite(rgb, 3, static_cast<size_t>(width) * height, f);
+  fclose(f);
+}
+
+void frame_pushed(const uint8_t *rgb, int width, int height) {
+  // Flips are told by which pixels are lit, so that brightness changes,
+  // which repaint the panel in other shades, do not count.
+  size_t size = static_cast<size_t>(width) * height;
+  std::vector<uint8_t> lit(size);
+  for (size_t i = 0; i < size; i++) {
+    lit[i] = rgb[i * 3] | rgb[i * 3 + 1] | rgb[i * 3 + 2] ? 1 : 0;
+  }
+  if (lit != last_frame) {
+    if (stats.rtc_loads > 0 && now - last_frame_change_us >= 500000) {
+      int64_t utc_us = true_utc_us(now);
+      // Signed distance to the nearest UTC second, in (-0.5, 0.5] s.
+      double phase = static_cast<double>(((utc_us % 1000000) + 1000000) % 1000000) / 1e6;
+      if (phase > 0.5) {
+        phase -= 1.0;
+      }
+      stats.flips++;
+      stats.flip_phase_sum += phase;
+      stats.flip_phase_min = std::min(stats.flip_phase_min, phase);
+      stats.flip_phase_max = std::max(stats.flip_phase_max, phase);
+    }
+    last_frame = lit;
+    last_frame_change_us = now;
+  }
+  if (!cfg.ppm_dir.empty()) {
+    write_ppm(rgb, width, height);
+  }
+  stats.frames++;
+}
+
+void advance(uint64_t to_us) {
+  if (to_us >= cfg.duration_us) {
+    now = cfg.duration_us;
+    finish();
+  }
+  now = std::max(now.load(), to_us);
+}
+
+void save_flash() {
+  if (cfg.flash_path.empty() || flash_image.empty()) {
+    return;
+  }
+  std::ofstream file(cfg.flash_path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(flash_image.data()), flash_image.size());
+  if (!file) {
+    fprintf(stderr, "sim: cannot save flash image to %s\n", cfg.flash_path.c_str());
+  }
+}
+
+bool access_point_reachable(uint64_t at_us) {
+  for (const Outage &outage : cfg.wifi_outages) {
+    if (at_us >= outage.from_us && at_us < outage.until_us) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Brings the association up to the current virtual time.
+void update_wifi() {
+  if (wifi_state == WifiState::joining && now >= wifi_join_done_us) {
+    if (access_point_reachable(wifi_join_done_us)) {
+      wifi_state = WifiState::up;
+      wifi_up_since_us = wifi_join_done_us;
+      if (stats.first_wifi_up_us < 0) {
+        stats.first_wifi_up_us = static_cast<int64_t>(wifi_join_done_us);
+      }
+    } else {
+      wifi_state = WifiState::failed;
+      stats.wifi_failed_joins++;
+    }
+  }
+  if (wifi_state == WifiState::up) {
+    for (const Outage &outage : cfg.wifi_outages) {
+      if (outage.from_us > wifi_up_since_us && outage.from_us <= now) {
+        wifi_state = WifiState::down;
+        stats.wifi_up_us += outage.from_us - wifi_up_since_us;
+        stats.wifi_drops++;
+        break;
+      }
+    }
+  }
+}
+
+// Whether a core 0 interrupt is due and can be taken.
+bool core0_irq_due() {
+  return !core0_in_irq && !core0_irqs.empty() && core0_irqs.begin()->first <= now;
+}
+
+bool all_waiting() {
+  if (core0_irq_due()) {
+    return false;  // core 0 is about to take it
+  }
+  for (const Core &core : cores) {
+    if (core.launched && !core.waiting) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether network work that core 0 would be woken for is due.
+bool net_work_due() {
+  return cores[0].wake_on_event && !net_work.empty() && net_work.begin()->first <= now;
+}
+
+void release_cores(bool on_event) {
+  for (int i = 0; i < 2; i++) {
+    Core &core = cores[i];
+    if (core.waiting && !core.held &&
+        (now >= core.until_us || (on_event && core.wake_on_event) || (i == 0 && net_work_due()))) {
+      core.waiting = false;
+    }
+  }
+  released.notify_all();
+}
+
+// Moves virtual time on to the next wait that ends or the next timer
+// interrupt, whichever comes first, and runs that interrupt. Interrupts
+// wake every core waiting for events; like WFE, a wait may end early.
+void step() {
+  uint64_t target = UINT64_MAX;
+  for (const Core &core : cores) {
+    if (core.launched && !core.held) {
+      target = std::min(target, core.until_us);
+    }
+  }
+  if (cores[0].wake_on_event && !net_work.empty()) {
+    target = std::min(target, std::max(now.load(), net_work.begin()->first));
+  }
+  if (!core0_in_irq && !core0_irqs.empty()) {
+    target = std::min(target, std::max(now.load(), core0_irqs.begin()->first));
+  }
+  if (!timers.empty() && timers.begin()->first <= target) {
+    advance(timers.begin()->first);
+    Work work = std::move(timers.begin()->second.work);
+    timers.erase(timers.begin());
+    work();
+    release_cores(true);
+  } else {
+    advance(target);
+    release_cores(false);
+  }
+}
+
+// Counts the frame the panel was last changed to as pushed.
+void push_changed_panel() {
+  if (changed_panel) {
+    frame_pushed(changed_panel, changed_width, changed_height);
+    changed_panel = nullptr;
+  }
+}
+
+// Blocks the calling core until `until_us`, or earlier on an event if
+// `wake_on_event`.
+void wait(uint64_t until_us, bool wake_on_event) {
+  std::unique_lock<std::recursive_mutex> guard(lock);
+  push_changed_panel();
+  Core &core = cores[this_core];
+  if (wake_on_event && core.event) {
+    core.event = false;
+    return;
+  }
+  core.waiting = true;
+  core.until_us = until_us;
+  core.wake_on_event = wake_on_event;
+  release_cores(false);  // may already be due
+  while (core.waiting) {
+    if (this_core == 0 && core0_irq_due()) {
+      // Taken in the middle of the wait, which goes on afterwards unless
+      // it was one for events.
+      uint64_t until = core.until_us;
+      Work work = std::move(core0_irqs.begin()->second.work);
+      core0_irqs.erase(core0_irqs.begin());
+      core.waiting = false;
+      core0_in_irq = true;
+      guard.unlock();
+      host_clock::time_point irq_since = host_clock::now();
+      work();
+      int64_t busy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          host_clock::now() - irq_since).count();
+      guard.lock();
+      core0_in_irq = false;
+      core.passes++;
+      core.busy_ns += busy_ns;
+      core.max_busy_ns = std::max(core.max_busy_ns, busy_ns);
+      push_changed_panel();
+      if (wake_on_event) {
+        break;
+      }
+      core.waiting = true;
+      core.until_us = until;
+      core.wake_on_event = false;
+      release_cores(false);
+      continue;
+    }
+    if (all_waiting()) {
+      step();
+    } else {
+      released.wait(guard);
+    }
+  }
+  core.event = false;
+}
+
+}  // namespace
+
+const Config &config() {
+  if (!cfg_loaded) {
+    load_config();
+  }
+  return cfg;
+}
+
+uint64_t now_us() {
+  return now;
+}
+
+int64_t true_utc_us(uint64_t device_us) {
+  // The device clock runs fast by drift_ppm relative to true time.
+  double elapsed = static_cast<double>(device_us) / (1.0 + config().drift_ppm * 1e-6);
+  return config().start_utc_us + llround(elapsed);
+}
+
+double random_unit() {
+  config();
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+uint32_t add_timer(uint64_t at_us, Work work) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  uint32_t id = next_timer_id++;
+  timers.emplace(at_us, Timer{id, std::move(work)});
+  return id;
+}
+
+bool cancel_timer(uint32_t id) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  for (auto it = timers.begin(); it != timers.end(); ++it) {
+    if (it->second.id == id) {
+      timers.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void add_net_work(uint64_t at_us, Work work) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (net_work_irq) {
+    add_core0_irq(at_us, [work] {
+      work();
+      if (cfg.net_work_us > 0) {
+        busy_wait(cfg.net_work_us);
+      }
+    });
+    return;
+  }
+  net_work.emplace(at_us, std::move(work));
+}
+
+void set_net_work_irq(bool irq) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  net_work_irq = irq;
+}
+
+uint32_t add_core0_irq(uint64_t at_us, Work work) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  uint32_t id = next_timer_id++;
+  core0_irqs.emplace(at_us, Timer{id, std::move(work)});
+  released.notify_all();  // core 0 may be waiting on it already
+  return id;
+}
+
+bool cancel_core0_irq(uint32_t id) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  for (auto it = core0_irqs.begin(); it != core0_irqs.end(); ++it) {
+    if (it->second.id == id) {
+      core0_irqs.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void run_net_work() {
+  while (true) {
+    Work work;
+    {
+      std::lock_guard<std::recursive_mutex> guard(lock);
+      if (net_work.empty() || net_work.begin()->first > now) {
+        return;
+      }
+      work = std::move(net_work.begin()->second);
+      net_work.erase(net_work.begin());
+    }
+    work();
+    if (cfg.net_work_us > 0) {
+      busy_wait(cfg.net_work_us);
+    }
+  }
+}
+
+void idle_until(uint64_t until_us, bool wake_on_event) {
+  config();
+  Core &core = cores[this_core];
+  host_clock::time_point idle_since = host_clock::now();
+  int64_t busy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      idle_since - core.busy_since).count();
+  {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    core.passes++;
+    core.busy_ns += busy_ns;
+    core.max_busy_ns = std::max(core.max_busy_ns, busy_ns);
+  }
+  wait(until_us, wake_on_event);
+  core.busy_since = host_clock::now();
+}
+
+void busy_wait(uint64_t us) {
+  config();
+  wait(now + us, false);
+}
+
+void send_event() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  for (int i = 0; i < 2; i++) {
+    Core &core = cores[i];
+    if (i == this_core || !core.launched) {
+      continue;
+    }
+    if (core.waiting && core.wake_on_event && !core.held) {
+      core.waiting = false;
+    } else {
+      core.event = true;
+    }
+  }
+  released.notify_all();
+}
+
+void lockout_other_core(bool hold) {
+  std::unique_lock<std::recursive_mutex> guard(lock);
+  Core &other = cores[1 - this_core];
+  if (!other.launched) {
+    return;
+  }
+  if (hold) {
+    while (!other.waiting) {
+      released.wait(guard);
+    }
+    other.held = true;
+    stats.lockouts++;
+    stats.lockout_since_us = now;
+    return;
+  }
+  other.held = false;
+  stats.max_lockout_us = std::max(stats.max_lockout_us, now - stats.lockout_since_us);
+  if (other.until_us < now) {
+    stats.held_up_waits++;
+  }
+  release_cores(false);
+}
+
+void wifi_join() {
+  config();
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  update_wifi();
+  if (wifi_state == WifiState::up) {
+    return;
+  }
+  wifi_state = WifiState::joining;
+  wifi_join_done_us = now + cfg.wifi_delay_us;
+  stats.wifi_joins++;
+}
+
+int wifi_link_status() {
+  config();
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  update_wifi();
+  switch (wifi_state) {
+    case WifiState::joining:
+      return CYW43_LINK_JOIN;
+    case WifiState::up:
+      return CYW43_LINK_UP;
+    case WifiState::failed:
+      return CYW43_LINK_NONET;
+    case WifiState::down:
+      break;
+  }
+  return CYW43_LINK_DOWN;
+}
+
+bool wifi_link_up() {
+  return wifi_link_status() == CYW43_LINK_UP;
+}
+
+uint8_t *flash() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (flash_image.empty()) {
+    flash_image.assign(PICO_FLASH_SIZE_BYTES, 0xff);
+    std::ifstream file(config().flash_path, std::ios::binary);
+    if (file) {
+      file.read(reinterpret_cast<char *>(flash_image.data()), flash_image.size());
+    }
+  }
+  return flash_image.data();
+}
+
+void flash_erase(uint32_t offset, size_t count) {
+  memset(flash() + offset, 0xff, count);
+  {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    stats.flash_erases += count / FLASH_SECTOR_SIZE;
+  }
+  busy_wait(count / FLASH_SECTOR_SIZE * flash_erase_us);
+}
+
+void flash_program(uint32_t offset, const uint8_t *data, size_t count) {
+  uint8_t *bytes = flash() + offset;
+  for (size_t i = 0; i < count; i++) {
+    bytes[i] &= data[i];  // programming only clears bits
+  }
+  {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    stats.flash_programs += count / FLASH_PAGE_SIZE;
+  }
+  busy_wait(count / FLASH_PAGE_SIZE * flash_program_us);
+}
+
+void launch_core1(void (*entry)()) {
+  config();
+  {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    cores[1].launched = true;
+    cores[1].busy_since = host_clock::now();
+  }
+  std::thread([entry] {
+    this_core = 1;
+    entry();
+  }).detach();
+}
+
+void panel_changed(const uint8_t *rgb, int width, int height, int pixels) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  stats.pixels += pixels;
+  changed_panel = rgb;
+  changed_width = width;
+  changed_height = height;
+}
+
+uint16_t light_reading() {
+  const Config &c = config();
+  double progress = c.duration_us ? static_cast<double>(now) / c.duration_us : 1.0;
+  double reading = c.light_start + (c.light_end - c.light_start) * std::min(progress, 1.0);
+  return static_cast<uint16_t>(std::clamp(reading, 0.0, 4095.0));
+}
+
+void brightness_set(int brightness) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (brightness == stats.brightness) {
+    return;
+  }
+  if (stats.brightness >= 0) {
+    stats.brightness_integral += stats.brightness * ((now - stats.brightness_since_us) / 1e6);
+    stats.brightness_changes++;
+  }
+  stats.brightness = brightness;
+  stats.brightness_since_us = now;
+  stats.brightness_min = std::min(stats.brightness_min, brightness);
+  stats.brightness_max = std::max(stats.brightness_max, brightness);
+}
+
+void rtc_loaded(int64_t rtc_epoch_s) {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  if (stats.first_rtc_load_us < 0) {
+    stats.first_rtc_load_us = static_cast<int64_t>(now);
+  }
+  stats.rtc_loads++;
+  stats.rtc_epoch_s = rtc_epoch_s;
+  stats.rtc_load_us = now;
+}
+
+void ntp_request_sent() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  stats.ntp_requests++;
+}
+
+void ntp_reply_sent() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  stats.ntp_replies++;
+}
+
+void dns_lookup() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  stats.dns_lookups++;
+}
+
+void finish() {
+  std::lock_guard<std::recursive_mutex> guard(lock);
+  double seconds = now / 1e6;
+  printf("sim: %.3f s virtual time, %" PRIu64 " frames (%.1f fps), %.1f pixels "
+         "converted per frame\n", seconds, stats.frames,
+         seconds > 0 ? stats.frames / seconds : 0.0,
+         stats.frames ? static_cast<double>(stats.pixels) / stats.frames : 0.0);
+  for (int i = 0; i < 2; i++) {
+    const Core &core = cores[i];
+    if (core.launched) {
+      printf("sim: core %d: %" PRIu64 " loop passes, busy %.3f ms host time, "
+             "%.2f us/pass avg, %.2f us max\n", i, core.passes, core.busy_ns / 1e6,
+             core.passes ? core.busy_ns / 1e3 / core.passes : 0.0, core.max_busy_ns / 1e3);
+    }
+  }
+  if (stats.brightness >= 0 && now > 0) {
+    double integral = stats.brightness_integral +
+                      stats.brightness * ((now - stats.brightness_since_us) / 1e6);
+    printf("sim: brightness avg %.1f %%, min %.1f %%, max %.1f %%, %" PRIu64 " changes\n",
+           integral / seconds / 2.56, stats.brightness_min / 2.56,
+           stats.brightness_max / 2.56, stats.brightness_changes);
+  }
+  printf("sim: NTP %" PRIu64 " requests, %" PRIu64 " replies, %" PRIu64 " DNS lookups\n",
+         stats.ntp_requests, stats.ntp_replies, stats.dns_lookups);
+  if (stats.rtc_loads > 0) {
+    // Continuous value of the RTC now, i.e. including its sub-second phase.
+    double rtc_s = stats.rtc_epoch_s + (now - stats.rtc_load_us) / 1e6;
+    double offset_s = wrap_quarter_hour(rtc_s - true_utc_us(now) / 1e6);
+    printf("sim: first RTC set at %.3f s, %" PRIu64 " sets, RTC offset vs UTC %+.3f s\n",
+           stats.first_rtc_load_us / 1e6, stats.rtc_loads, offset_s);
+  } else {
+    printf("sim: RTC never set\n");
+  }
+  if (stats.flips > 0) {
+    printf("sim: %" PRIu64 " second flips, phase vs UTC avg %+.1f ms, min %+.1f ms, max %+.1f ms\n",
+           stats.flips, stats.flip_phase_sum / stats.flips * 1e3,
+           stats.flip_phase_min * 1e3, stats.flip_phase_max * 1e3);
+  }
+  update_wifi();
+  if (stats.wifi_joins > 0) {
+    uint64_t up_us = stats.wifi_up_us + (wifi_state == WifiState::up ? now - wifi_up_since_us : 0);
+    printf("sim: Wi-Fi %" PRIu64 " joins, %" PRIu64 " failed, %" PRIu64 " link drops, ",
+           stats.wifi_joins, stats.wifi_failed_joins, stats.wifi_drops);
+    if (stats.first_wifi_up_us >= 0) {
+      printf("first up at %.3f s, up %.1f %% of the time\n", stats.first_wifi_up_us / 1e6,
+             seconds > 0 ? up_us / 1e4 / seconds : 0.0);
+    } else {
+      printf("never up\n");
+    }
+  }
+  if (stats.flash_erases > 0 || stats.flash_programs > 0) {
+    printf("sim: flash %" PRIu64 " sector erases, %" PRIu64 " page programs\n",
+           stats.flash_erases, stats.flash_programs);
+  }
+  if (stats.lockouts > 0) {
+    printf("sim: core 1 locked out %" PRIu64 " times, longest %.1f ms, %" PRIu64
+           " waits held up\n", stats.lockouts, stats.max_lockout_us / 1e3, stats.held_up_waits);
+  }
+  save_flash();
+  // The other core is still parked in a wait; do not tear down under it.
+  fflush(stdout);
+  fflush(stderr);
+  _Exit(0);
+}
+
+}  // namespace sim
@@ -0,0 +1,153 @@
+// Simulator core for the host build: a virtual device clock with timer
+// and network work queues, stand-in NTP servers, and the measurements
+// printed when a run ends.
+//
+// Runs are configured through environment variables:
+//
+//   NTP_RTC_SIM_SECONDS    virtual run time in seconds (default 120)
+//   NTP_RTC_SIM_START      true UTC at power-on, Unix seconds (default 1700000000.25)
+//   NTP_RTC_SIM_DRIFT_PPM  crystal frequency error of the device (default 0)
+//   NTP_RTC_SIM_SERVERS    comma separated offset_ms:delay_ms:jitter_ms:loss
+//                          per stand-in NTP server (default 0:12:3:0)
+//   NTP_RTC_SIM_DNS_MS     DNS resolution delay (default 20)
+//   NTP_RTC_SIM_DNS_FAIL   probability that a DNS lookup fails (default 0)
+//   NTP_RTC_SIM_NET_WORK_US  time the cyw43 arch keeps core 0 busy per
+//                          received packet or DNS answer (default 0)
+//   NTP_RTC_SIM_WIFI_MS    Wi-Fi association delay (default 1500)
+//   NTP_RTC_SIM_WIFI_DOWN  comma separated from_s:seconds per outage of the
+//                          access point; it drops the association, and joins
+//                          fail until it is over (default none)
+//   NTP_RTC_SIM_LIGHT      light sensor reading, 0 to 4095, or start:end for
+//                          a linear change over the run (default 2000)
+//   NTP_RTC_SIM_PPM_DIR    directory to dump every pushed frame into as PPM
+//   NTP_RTC_SIM_FLASH      file the flash image is loaded from, if it exists,
+//                          and saved to at the end, to keep the flash
+//                          journal across runs
+//   NTP_RTC_SIM_SEED       seed for network jitter and loss (default 1)
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef NTP_RTC_HOST_SIM_HPP
+#define NTP_RTC_HOST_SIM_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "lwip/ip_addr.h"
+
+namespace sim {
+
+struct Server {
+  ip_addr_t address;    //!< address the server's name resolves to
+  int64_t   offset_us;  //!< server clock minus true UTC
+  int64_t   delay_us;   //!< one-way network delay
+  int64_t   jitter_us;  //!< upper bound of random extra one-way delay
+  double    loss;       //!< probability that a request or its reply is lost
+};
+
+struct Outage {
+  uint64_t from_us;   //!< device time the access point goes away
+  uint64_t until_us;  //!< and comes back
+};
+
+struct Config {
+  uint64_t            duration_us;
+  int64_t             start_utc_us;
+  double              drift_ppm;
+  std::vector<Server> servers;
+  uint64_t            dns_delay_us;
+  double              dns_failure;
+  uint64_t            net_work_us;
+  uint64_t            wifi_delay_us;
+  std::vector<Outage> wifi_outages;
+  double              light_start;
+  double              light_end;
+  std::string         ppm_dir;
+  std::string         flash_path;
+  uint32_t            seed;
+};
+
+const Config &config();
+
+// Device time (what time_us_64() returns) and the true UTC at a device time.
+uint64_t now_us();
+int64_t true_utc_us(uint64_t device_us);
+
+// Light sensor reading at the current virtual time.
+uint16_t light_reading();
+
+// Uniform random number in [0, 1) from the seeded simulation generator.
+double random_unit();
+
+using Work = std::function<void()>;
+
+// Timer interrupts run as soon as the virtual clock reaches their time.
+uint32_t add_timer(uint64_t at_us, Work work);
+bool cancel_timer(uint32_t id);
+
+// Network work runs from cyw43_arch_poll() on core 0 once its time has
+// come, or, after set_net_work_irq(true), as a core 0 interrupt.
+void add_net_work(uint64_t at_us, Work work);
+void run_net_work();
+void set_net_work_irq(bool irq);
+
+// Core 0 interrupts other than timers, like the one the threadsafe_background
+// cyw43 arch runs its work from. They run on core 0 once due, also while it
+// is busy or sleeps, end a wait for events, and do not nest.
+uint32_t add_core0_irq(uint64_t at_us, Work work);
+bool cancel_core0_irq(uint32_t id);
+
+// Core 0 is the thread that runs main(); multicore_launch_core1() starts
+// core 1 on a second thread. The cores run concurrently, and the virtual
+// clock advances once both of them wait.
+void launch_core1(void (*entry)());
+
+// Waits on the calling core until `until_us`, running timer interrupts on
+// the way. With `wake_on_event`, returns after the first interrupt, an
+// event from the other core, or when network work for core 0 becomes due,
+// like a WFE-based wait on the device.
+void idle_until(uint64_t until_us, bool wake_on_event);
+
+// Keeps the calling core busy for `us` of virtual time. The other core and
+// timer interrupts go on meanwhile.
+void busy_wait(uint64_t us);
+
+// Wakes the other core if it waits for events, or else latches one for
+// its next wait (SEV).
+void send_event();
+
+// Holds the other core at its next wait, or lets it go again, like the
+// multicore lockout. Waits it would have ended meanwhile are held up.
+void lockout_other_core(bool hold);
+
+// Wi-Fi association. A join completes after the association delay, or
+// fails if the access point is out of reach by then; an outage drops the
+// association. The status is one of the CYW43_LINK_* values.
+void wifi_join();
+int wifi_link_status();
+bool wifi_link_up();
+
+// Flash image of PICO_FLASH_SIZE_BYTES, and the operations that change it;
+// these keep the calling core busy for as long as the chip would.
+uint8_t *flash();
+void flash_erase(uint32_t offset, size_t count);
+void flash_program(uint32_t offset, const uint8_t *data, size_t count);
+
+// Measurement hooks for the stand-in drivers. The panel shows `rgb` from
+// now on, after the driver converted `pixels` colours into its bitplanes;
+// changes made in one go, until the core next waits, count as one frame.
+void panel_changed(const uint8_t *rgb, int width, int height, int pixels);
+void brightness_set(int brightness);  //!< in 1/256 of full brightness
+void rtc_loaded(int64_t rtc_epoch_s);
+void ntp_request_sent();
+void ntp_reply_sent();
+void dns_lookup();
+
+// Prints the run report and exits the process.
+[[noreturn]] void finish();
+
+}  // namespace sim
+
+#endif  // NTP_RTC_HOST_SIM_HPP
@@ -0,0 +1,87 @@
+// Host benchmark for the text of ntp_rtc_simple_text: shows days of
+// seconds as "HH:MM:SS" the way write_text() used to, clearing the panel
+// and drawing the whole line with draw_text(), and through TextLine, which
+// draws only the glyphs from the first changed one on. Both are timed with
+// and without converting the canvas for the panel.
+//
+// Costs are host nanoseconds and only meaningful relative to each other.
+// present() sends the changed pixels to the simulator's stand-in panel.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "galactic_unicorn.hpp"
+#include "civil_time.hpp"
+#include "palette_canvas.hpp"
+#include "text_font.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+using pimoroni::GalacticUnicorn;
+
+constexpr int text_top = 2;
+constexpr int seconds_per_day = 86400;
+
+PaletteCanvas<GalacticUnicorn::WIDTH, GalacticUnicorn::HEIGHT, 1> graphics;
+GalacticUnicorn galactic_unicorn;
+int white = 0;
+
+void redraw_all(std::string_view text) {
+  graphics.set_pen(0);
+  graphics.clear();
+  graphics.set_pen(white);
+  draw_text(graphics, text_font, 0, text_top, text);
+}
+
+// Time per second shown over `days` days of seconds
+template <typename F>
+double ns_per_second(int days, F show) {
+  TimeDigits digits;
+  digits.set(0, 0, 0);
+  bench_clock::time_point start = bench_clock::now();
+  for (int i = 0; i < days * seconds_per_day; i++) {
+    const uint8_t *d = digits.digits;
+    char text[8] = {
+      static_cast<char>('0' + d[0]), static_cast<char>('0' + d[1]), ':',
+      static_cast<char>('0' + d[2]), static_cast<char>('0' + d[3]), ':',
+      static_cast<char>('0' + d[4]), static_cast<char>('0' + d[5]),
+    };
+    show(std::string_view(text, sizeof(text)));
+    digits.tick();
+  }
+  std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(days) * seconds_per_day);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 20;
+  galactic_unicorn.init();
+  white = graphics.create_pen(255, 255, 255);
+  TextLine line(text_font, 0, text_top);
+  TextLine presented(text_font, 0, text_top);
+
+  printf("text_line_bench: %d days of seconds\n", days);
+  printf("  clear + draw_text:            %7.1f ns\n",
+         ns_per_second(days, [](std::string_view text) { redraw_all(text); }));
+  printf("  TextLine::show:               %7.1f ns\n",
+         ns_per_second(days, [&line](std::string_view text) { line.show(graphics, text, 0, white); }));
+  printf("  clear + draw_text + present:  %7.1f ns\n",
+         ns_per_second(days, [](std::string_view text) {
+           redraw_all(text);
+           graphics.present(galactic_unicorn);
+         }));
+  printf("  TextLine::show + present:     %7.1f ns\n",
+         ns_per_second(days, [&presented](std::string_view text) {
+           if (presented.show(graphics, text, 0, white)) {
+             graphics.present(galactic_unicorn);
+           }
+         }));
+  return 0;
+}
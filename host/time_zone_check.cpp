@@ -0,0 +1,71 @@
+// Host check of the compiled time zones against the C library: for every
+// zone of the table, the UTC offset and abbreviation LocalTime gives for
+// each hour from 2025 to 2045, and for the seconds either side of every
+// change, against localtime_r() with TZ set to the zone. Prints the first
+// mismatches and exits with status 1 if there are any.
+//
+// Needs the system's zoneinfo, and agrees with it only for the years the
+// zones' current rules hold for.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "time_zone.hpp"
+#include "time_zones.hpp"
+
+namespace {
+
+constexpr int first_year = 2025;
+constexpr int last_year = 2045;
+constexpr int max_reports = 10;
+
+int failures = 0;
+
+void fail(const char *zone, const char *what, int64_t second) {
+  if (failures++ < max_reports) {
+    printf("mismatch: %s %s at %" PRId64 "\n", zone, what, second);
+  }
+}
+
+void check_second(const TimeZone &zone, LocalTime &local_time, int64_t second) {
+  time_t epoch = static_cast<time_t>(second);
+  struct tm expected;
+  localtime_r(&epoch, &expected);
+  if (local_time.offset(second) != expected.tm_gmtoff) {
+    fail(zone.name, "offset", second);
+  } else if (strcmp(local_time.abbreviation(second), expected.tm_zone) != 0) {
+    fail(zone.name, "abbreviation", second);
+  }
+}
+
+}  // namespace
+
+int main() {
+  int64_t first = days_from_civil(first_year, 1, 1) * 86400;
+  int64_t last = days_from_civil(last_year + 1, 1, 1) * 86400;
+  for (const TimeZone &zone : time_zones.zones) {
+    setenv("TZ", zone.name, 1);
+    tzset();
+    LocalTime local_time;
+    local_time.set_zone(zone);
+    for (int64_t second = first; second < last; second += 3600) {
+      check_second(zone, local_time, second);
+    }
+    for (int year = first_year; year <= last_year; year++) {
+      for (int r = 0; r < zone.num_rules; r++) {
+        int64_t change = zone.change(zone.rules[r], year, zone.rules[1 - r].offset);
+        // Backwards as well, so the cached span is left at both ends.
+        check_second(zone, local_time, change);
+        check_second(zone, local_time, change - 1);
+      }
+    }
+  }
+  printf("time_zone: %d zones from %d to %d, %s\n", time_zones.size(), first_year, last_year,
+         failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef MAILBOX_HPP
+#define MAILBOX_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free queue from one producer to one consumer, such as from one core
+// to the other. Each index is written by one side only, so plain atomic
+// loads and stores with acquire/release ordering suffice; the Cortex-M0+
+// has no atomic read-modify-write instructions, and none are needed.
+template <typename T, uint32_t N>
+class Mailbox {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "indices must be lock-free");
+
+public:
+  // Producer side. Returns false, dropping nothing, if the mailbox is full.
+  bool push(const T &item) {
+    uint32_t head = write_index.load(std::memory_order_relaxed);
+    if (head - read_index.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+    items[head % N] = item;
+    write_index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the mailbox is empty.
+  bool pop(T *item) {
+    uint32_t tail = read_index.load(std::memory_order_relaxed);
+    if (tail == write_index.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = items[tail % N];
+    read_index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T items[N];
+  std::atomic<uint32_t> write_index{0};  //!< items pushed so far, wrapping
+  std::atomic<uint32_t> read_index{0};   //!< items popped so far, wrapping
+};
+
+#endif  // MAILBOX_HPP
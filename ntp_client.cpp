@@ -0,0 +1,284 @@
+// Based on NTP-client of pico-examples.
+//
+// (c) 2022 Raspberry Pi Ltd.
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cinttypes>
+#include <new>
+#include <string.h>
+
+#include "lwip/dns.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "pico/cyw43_arch.h"
+#include "ntp_client.hpp"
+#include "ntp_time.hpp"
+#include "scheduler.hpp"
+
+#define NTP_PORT 123
+#define NTP_RETRY_INTERVAL (64 * 1000)
+#define NTP_RESEND_INTERVAL (10 * 1000)
+#define NTP_BURST_POLLS 4
+#define NTP_BURST_INTERVAL (2 * 1000)
+
+// Each name of the pool resolves to a different random server.
+static const char *const ntp_servers[NTP_SERVER_COUNT] = {
+  "0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "3.pool.ntp.org"
+};
+
+// Has the poll looked at once the work at hand is done; also from interrupts.
+static void ntp_check_done(NTP_T *state) {
+  async_context_set_work_pending(cyw43_arch_async_context(), &state->done_worker);
+}
+
+// Submit NTP request via UDP. The prepared request is lent to lwIP rather
+// than copied into a new pbuf; only its transmit timestamp changes.
+static void ntp_request(NtpPeer *peer) {
+  NTP_T *state = peer->state;
+  // cyw43_arch_lwip_begin/end should be used around calls into lwIP to ensure
+  // correct locking. You can omit them if you are in a callback from lwIP. Note
+  // that when using pico_cyw_arch_poll these calls are a no-op and can be
+  // omitted, but it is a good practice to use them in case you switch the
+  // cyw43_arch type later.
+  cyw43_arch_lwip_begin();
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NtpPacketView::size, PBUF_REF);
+  if (!p) {
+    cyw43_arch_lwip_end();
+    printf("failed to allocate NTP request\n");
+    return;
+  }
+  p->payload = state->request;
+  // Our transmit timestamp (T1) on the disciplined timebase
+  peer->request_sent_us = time_us_64();
+  peer->origin = unix_us_to_ntp(state->timebase->utc_us(peer->request_sent_us));
+  ntp_set_transmit_timestamp(state->request, peer->origin);
+  udp_sendto(state->ntp_pcb, p, &peer->address, NTP_PORT);
+  pbuf_free(p);
+  cyw43_arch_lwip_end();
+}
+
+static int64_t ntp_failed_handler(alarm_id_t id, void *user_data) {
+  NTP_T *state = (NTP_T *)user_data;
+  state->ntp_resend_alarm = 0;
+  state->poll_expired = true;
+  ntp_check_done(state);
+  return 0;
+}
+
+// Callback with DNS response
+static void ntp_dns_found(const char *hostname, const ip_addr_t *ipaddr,
+                          void *arg) {
+  NtpPeer *peer = (NtpPeer *)arg;
+  if (!ipaddr) {
+    printf("NTP DNS request for %s failed\n", hostname);
+    peer->pending = false;
+    ntp_check_done(peer->state);
+    return;
+  }
+  // Several names of the pool may lead to the same server.
+  for (const NtpPeer &other : peer->state->peers) {
+    if (&other != peer && other.resolved && ip_addr_cmp(&other.address, ipaddr)) {
+      peer->pending = false;
+      ntp_check_done(peer->state);
+      return;
+    }
+  }
+  if (!ip_addr_cmp(&peer->address, ipaddr)) {
+    peer->filter.clear();  // samples of another server
+  }
+  peer->address = *ipaddr;
+  peer->resolved = true;
+  printf("NTP address %s\n", ipaddr_ntoa(ipaddr));
+  ntp_request(peer);
+}
+
+// NTP data received
+static void ntp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                     const ip_addr_t *addr, u16_t port) {
+  NTP_T *state = (NTP_T *)arg;
+  uint64_t received_us = time_us_64();  // T4, before anything else
+  NtpPeer *peer = nullptr;
+  for (NtpPeer &candidate : state->peers) {
+    if (candidate.pending && candidate.resolved && ip_addr_cmp(addr, &candidate.address)) {
+      peer = &candidate;
+    }
+  }
+  // A reply normally sits in one pbuf and is read in place.
+  uint8_t copy[NtpPacketView::size] = {0};
+  const uint8_t *data = (const uint8_t *)p->payload;
+  if (p->len < NtpPacketView::size) {
+    pbuf_copy_partial(p, copy, sizeof(copy), 0);
+    data = copy;
+  }
+  NtpReply reply = (peer && port == NTP_PORT)
+    ? ntp_check_reply(data, p->tot_len, peer->origin) : NtpReply::malformed;
+  NtpPacketView packet(data);
+  if (reply == NtpReply::ok) {
+    int64_t pivot_s = state->timebase->synchronised()
+      ? state->timebase->utc_us(received_us) / 1000000 : ntp_default_pivot_s;
+    int64_t server_received_us = ntp_to_unix_us(packet.receive_timestamp(), pivot_s);      // T2
+    int64_t server_transmitted_us = ntp_to_unix_us(packet.transmit_timestamp(), pivot_s);  // T3
+    NtpSample sample = ntp_sample(static_cast<int64_t>(peer->request_sent_us),
+                                  server_received_us, server_transmitted_us,
+                                  static_cast<int64_t>(received_us));
+    peer->filter.add(received_us, sample);
+    peer->pending = false;
+    peer->replied = true;
+  } else if (reply == NtpReply::kiss_of_death) {
+    printf("NTP kiss-o'-death %.4s from %s\n", packet.kiss_code(), ipaddr_ntoa(addr));
+    peer->pending = false;
+    // RATE asks for polls further apart, which the poll interval sees to;
+    // anything else means to stop using the server.
+    if (strncmp(packet.kiss_code(), "RATE", 4) != 0) {
+      state->dns_cache.reject(peer->hostname, &peer->address);
+    }
+  } else {
+    printf("invalid NTP response from %s\n", ipaddr_ntoa(addr));
+  }
+  pbuf_free(p);
+  ntp_check_done(state);
+}
+
+void ntp_start_poll(NTP_T *state) {
+  state->poll_active = true;
+  state->poll_expired = false;
+  // Set alarm in case udp requests are lost
+  state->ntp_resend_alarm = add_alarm_in_ms(
+      state->burst_polls > 0 ? NTP_BURST_INTERVAL : NTP_RESEND_INTERVAL,
+      ntp_failed_handler, state, true);
+  for (NtpPeer &peer : state->peers) {
+    peer.resolved = false;
+    peer.pending = true;
+    peer.replied = false;
+  }
+  for (NtpPeer &peer : state->peers) {
+    // cyw43_arch_lwip_begin/end should be used around calls into lwIP to
+    // ensure correct locking. You can omit them if you are in a callback from
+    // lwIP. Note that when using pico_cyw_arch_poll these calls are a no-op
+    // and can be omitted, but it is a good practice to use them in case you
+    // switch the cyw43_arch type later.
+    ip_addr_t address;
+    cyw43_arch_lwip_begin();
+    int err = state->dns_cache.lookup(peer.hostname, &address, ntp_dns_found, &peer);
+    cyw43_arch_lwip_end();
+
+    if (err == ERR_OK) {
+      ntp_dns_found(peer.hostname, &address, &peer);  // Cached result
+    } else if (err != ERR_INPROGRESS) {  // ERR_INPROGRESS means expect a callback
+      printf("dns request failed\n");
+      peer.pending = false;
+    }
+  }
+  ntp_check_done(state);
+}
+
+bool ntp_poll_done(const NTP_T *state) {
+  if (state->poll_expired) {
+    return true;
+  }
+  int pending = 0;
+  int replied = 0;
+  for (const NtpPeer &peer : state->peers) {
+    pending += peer.pending;
+    replied += peer.replied;
+  }
+  return pending == 0 || (!state->timebase->confirmed() && replied > pending);
+}
+
+NtpPoll ntp_finish_poll(NTP_T *state, NtpSample *sample) {
+  const ClockDiscipline &timebase = *state->timebase;
+  if (state->burst_polls > 0) {
+    state->burst_polls--;
+  }
+  int resolved = 0;
+  int replied = 0;
+  for (const NtpPeer &peer : state->peers) {
+    resolved += peer.resolved;
+    replied += peer.replied;
+    // Servers are not to blame for replies lost with the Wi-Fi link.
+    if (state->poll_expired && peer.resolved && !peer.replied && state->wifi->up()) {
+      state->dns_cache.reject(peer.hostname, &peer.address);
+    }
+  }
+  if (replied == 0) {
+    printf(resolved ? "NTP request failed\n" : "NTP DNS failed\n");
+    return resolved ? NtpPoll::request_failed : NtpPoll::dns_failed;
+  }
+
+  uint64_t now = time_us_64();
+  NtpSample samples[NTP_SERVER_COUNT];
+  uint64_t taken_us[NTP_SERVER_COUNT];
+  bool truechimer[NTP_SERVER_COUNT];
+  int count = 0;
+  for (const NtpPeer &peer : state->peers) {
+    if (peer.filter.best(now, timebase.frequency(), &samples[count], &taken_us[count])) {
+      count++;
+    }
+  }
+  int survivors = ntp_select_truechimers(samples, count, truechimer);
+  printf("NTP: %d of %d servers replied, %d agree\n", replied, count, survivors);
+  if (survivors == 0) {
+    return NtpPoll::no_news;
+  }
+  // The first reply of the startup burst sets the clock right away, also
+  // over a time restored from before, the rest fill the filters so that
+  // its end can pick the best samples.
+  if (timebase.confirmed() && state->burst_polls > 0) {
+    return NtpPoll::no_news;
+  }
+  // Only samples taken since the last update tell the timebase anything new.
+  uint64_t newest_us = 0;
+  for (int i = 0; i < count; i++) {
+    if (truechimer[i] && taken_us[i] > newest_us) {
+      newest_us = taken_us[i];
+    }
+  }
+  if (newest_us <= state->last_sample_us) {
+    return NtpPoll::no_news;
+  }
+  state->last_sample_us = newest_us;
+  *sample = ntp_combine(samples, count, truechimer);
+  return NtpPoll::sample;
+}
+
+void ntp_end_poll(NTP_T *state, bool ok) {
+  if (state->ntp_resend_alarm > 0) {
+    cancel_alarm(state->ntp_resend_alarm);
+    state->ntp_resend_alarm = 0;
+  }
+  uint32_t next_poll_ms = NTP_RETRY_INTERVAL;
+  if (state->burst_polls > 0) {
+    next_poll_ms = NTP_BURST_INTERVAL;
+  } else if (ok) {
+    next_poll_ms = state->timebase->poll_interval_s() * 1000;
+  }
+  reschedule(cyw43_arch_async_context(), &state->poll_worker, make_timeout_time_ms(next_poll_ms));
+  state->poll_active = false;
+}
+
+// Initialisation of NTP client
+NTP_T *ntp_init(const ClockDiscipline *timebase, const WifiLink *wifi) {
+  // Value-initialised, so that the filters and the DNS cache start from
+  // their member initialisers and everything else from zero.
+  NTP_T *state = new (std::nothrow) NTP_T{};
+  if (!state) {
+    printf("failed to allocate NTP state\n");
+    return NULL;
+  }
+  state->ntp_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+  if (!state->ntp_pcb) {
+    printf("failed to create PCB\n");
+    delete state;
+    return NULL;
+  }
+  state->timebase = timebase;
+  state->wifi = wifi;
+  state->burst_polls = NTP_BURST_POLLS;
+  ntp_prepare_request(state->request);
+  for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+    state->peers[i].state = state;
+    state->peers[i].hostname = ntp_servers[i];
+  }
+  udp_recv(state->ntp_pcb, ntp_recv, state);
+  return state;
+}
@@ -0,0 +1,83 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef NTP_CLIENT_HPP
+#define NTP_CLIENT_HPP
+
+#include <cstdint>
+
+#include "lwip/ip_addr.h"
+#include "pico/async_context.h"
+#include "pico/stdlib.h"
+#include "clock_discipline.hpp"
+#include "dns_cache.hpp"
+#include "ntp_packet.hpp"
+#include "ntp_select.hpp"
+#include "wifi_link.hpp"
+
+// NTP client of both clocks, built once into the ntp_rtc_core library.
+// A poll looks up every server of the pool, sends each its request and
+// collects the replies until all are in or the poll expires; what the
+// clock makes of the result is up to the caller (see clock_app.hpp).
+
+#define NTP_SERVER_COUNT 4
+
+struct NTP_T;
+
+// One server of the pool and its recent samples
+struct NtpPeer {
+  NTP_T          *state;
+  const char     *hostname;
+  ip_addr_t       address;            //!< looked-up IP address of the server
+  bool            resolved;           //!< address was looked up during the current poll
+  bool            pending;            //!< DNS lookup or reply of the current poll still outstanding
+  bool            replied;            //!< a valid reply came in during the current poll
+  uint64_t        request_sent_us;    //!< time_us_64() when the last request was sent (T1)
+  uint64_t        origin;             //!< transmit timestamp of that request, echoed back by the server
+  SampleFilter    filter;
+};
+
+struct NTP_T {
+  NtpPeer         peers[NTP_SERVER_COUNT];
+  const ClockDiscipline *timebase;    //!< the clock's timebase, stamps requests and replies
+  const WifiLink *wifi;               //!< replies lost with the link are no server's fault
+  bool            poll_active;        //!< requests of a poll are out, collecting replies
+  volatile bool   poll_expired;       //!< ntp_resend_alarm went off before all servers replied
+  struct udp_pcb *ntp_pcb;            //!< UDP Protocol Control Block, shared by all servers
+  async_at_time_worker_t poll_worker;       //!< starts the next poll
+  async_when_pending_worker_t done_worker;  //!< sees whether the poll is over
+  alarm_id_t      ntp_resend_alarm;   //!< Alarm ending a poll in case request UDP packages are lost
+  uint64_t        last_sample_us;     //!< when the newest sample given to the timebase was taken
+  int             burst_polls;        //!< polls of the startup burst still to come
+  DnsCache        dns_cache;          //!< addresses of the pool names, kept across polls
+  uint8_t         request[NtpPacketView::size];  //!< request packet, prepared once and lent to each pbuf
+};
+
+// How a poll ended, see ntp_finish_poll()
+enum class NtpPoll : uint8_t {
+  dns_failed,      //!< no server could be looked up
+  request_failed,  //!< no server replied
+  no_news,         //!< replies came in, but nothing the timebase has not seen
+  sample,          //!< a new sample for the timebase
+};
+
+// Sets up the client on `timebase`; the state is released with delete. The
+// caller fills in the do_work of both workers; done_worker is set pending
+// whenever the poll may be over.
+NTP_T *ntp_init(const ClockDiscipline *timebase, const WifiLink *wifi);
+
+// Looks up every server of the pool; each gets its request once resolved.
+void ntp_start_poll(NTP_T *state);
+
+// A poll is over once every server replied or failed, or when it expired.
+// Until a sample confirmed the clock, a majority of the servers is enough.
+bool ntp_poll_done(const NTP_T *state);
+
+// Chooses the time from the best sample of each server, leaving out
+// falsetickers; `sample` is set if the result is NtpPoll::sample.
+NtpPoll ntp_finish_poll(NTP_T *state, NtpSample *sample);
+
+// Schedules the next poll once the result of this one is applied, sooner
+// after a failed one.
+void ntp_end_poll(NTP_T *state, bool ok);
+
+#endif  // NTP_CLIENT_HPP
@@ -0,0 +1,98 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef NTP_PACKET_HPP
+#define NTP_PACKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "ntp_time.hpp"
+
+// Read-only view of an NTP packet (RFC 5905, 7.3) in place, e.g. over a
+// pbuf payload. The 48 bytes behind `data` must stay valid; fields are
+// decoded from network byte order on access.
+class NtpPacketView {
+public:
+  static constexpr size_t size = 48;
+
+  explicit constexpr NtpPacketView(const uint8_t *data) : data(data) {}
+
+  uint8_t leap() const { return data[0] >> 6; }
+  uint8_t version() const { return (data[0] >> 3) & 0x7; }
+  uint8_t mode() const { return data[0] & 0x7; }
+  uint8_t stratum() const { return data[1]; }
+  int8_t poll() const { return static_cast<int8_t>(data[2]); }
+  int8_t precision() const { return static_cast<int8_t>(data[3]); }
+  uint32_t root_delay() const { return read32(4); }        //!< 16.16 seconds
+  uint32_t root_dispersion() const { return read32(8); }   //!< 16.16 seconds
+  uint32_t reference_id() const { return read32(12); }
+  uint64_t reference_timestamp() const { return read64(16); }
+  uint64_t origin_timestamp() const { return read64(24); }
+  uint64_t receive_timestamp() const { return read64(32); }
+  uint64_t transmit_timestamp() const { return read64(40); }
+
+  // ASCII code of a kiss-o'-death packet, such as "RATE", not terminated.
+  const char *kiss_code() const { return reinterpret_cast<const char *>(data + 12); }
+
+private:
+  uint32_t read32(size_t offset) const {
+    return static_cast<uint32_t>(data[offset]) << 24 | data[offset + 1] << 16 |
+           data[offset + 2] << 8 | data[offset + 3];
+  }
+
+  uint64_t read64(size_t offset) const {
+    return static_cast<uint64_t>(read32(offset)) << 32 | read32(offset + 4);
+  }
+
+  const uint8_t *data;
+};
+
+enum class NtpReply {
+  ok,
+  malformed,       //!< too short, not from a server, or without transmit timestamp
+  bogus,           //!< origin timestamp is not that of our request
+  unsynchronised,  //!< server's clock is not set (leap indicator 3 or stratum > 15)
+  kiss_of_death,   //!< stratum 0: the server tells us to back off or go away
+};
+
+// Checks a server's reply of `length` bytes to the request that carried
+// `origin` as its transmit timestamp.
+inline NtpReply ntp_check_reply(const uint8_t *data, size_t length, uint64_t origin) {
+  if (length < NtpPacketView::size) {
+    return NtpReply::malformed;
+  }
+  NtpPacketView packet(data);
+  if (packet.mode() != 4 || packet.version() < 1 || packet.version() > 4 ||
+      packet.transmit_timestamp() == 0) {
+    return NtpReply::malformed;
+  }
+  // Also rejects replayed and duplicate replies, and any packet not sent
+  // in reply to our latest request.
+  if (packet.origin_timestamp() != origin) {
+    return NtpReply::bogus;
+  }
+  if (packet.stratum() == 0) {
+    return NtpReply::kiss_of_death;
+  }
+  if (packet.leap() == 3 || packet.stratum() > 15) {
+    return NtpReply::unsynchronised;
+  }
+  return NtpReply::ok;
+}
+
+// Fills `packet` with a client request (version 3, mode 3) that still
+// needs its transmit timestamp.
+inline void ntp_prepare_request(uint8_t *packet) {
+  memset(packet, 0, NtpPacketView::size);
+  packet[0] = 0x1b;
+}
+
+inline void ntp_set_transmit_timestamp(uint8_t *packet, uint64_t timestamp) {
+  for (int i = 47; i >= 40; i--) {
+    packet[i] = static_cast<uint8_t>(timestamp);
+    timestamp >>= 8;
+  }
+}
+
+#endif  // NTP_PACKET_HPP
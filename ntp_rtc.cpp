@@ -6,349 +6,500 @@
 
 #include <cinttypes>
 #include <string.h>
-#include <time.h>
 
-#include "hardware/rtc.h"
-#include "lwip/dns.h"
-#include "lwip/pbuf.h"
-#include "lwip/udp.h"
 #include "pico/cyw43_arch.h"
-#include "pico/util/datetime.h"
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "libraries/pico_graphics/pico_graphics.hpp"
 #include "galactic_unicorn.hpp"
-#include "digits.hpp"
+#include "brightness.hpp"
+#include "clock_app.hpp"
+#include "digit_font.hpp"
+#include "mailbox.hpp"
+#include "palette_canvas.hpp"
+#include "scheduler.hpp"
+#include "second_tick.hpp"
+#include "text_font.hpp"
+#include "time_zone.hpp"
+#include "time_zones.hpp"
+#include "transition.hpp"
 
-#define NTP_SERVER "pool.ntp.org"
-#define NTP_MSG_LEN 48
-#define NTP_PORT 123
-#define NTP_DELTA 2208988800  // seconds between 1 Jan 1900 and 1 Jan 1970
-#define NTP_POLL_INTERVAL (60 * 1000)
-#define NTP_RESEND_INTERVAL (10 * 1000)
-#define UTC_OFFSET_SECONDS (2 * 3600)
-
-using pimoroni::PicoGraphics_PenRGB888;
 using pimoroni::GalacticUnicorn;
 using pimoroni::Point;
 using pimoroni::Rect;
 
-struct NTP_T {
-  ip_addr_t       ntp_server_address; //!< looked-up IP address of a NTP server in the pool
-  bool            dns_request_sent;   //!< DNS request was sent and reply receive (may have failed)
-  struct udp_pcb *ntp_pcb;            //!< UDP Protocol Control Block
-  absolute_time_t ntp_poll_time;      //!< Time for next NTP poll
-  alarm_id_t      ntp_resend_alarm;   //!< Alarm for resending NTP request in case request UDP package is lost
-};
-
 struct Color {
   uint8_t red;
   uint8_t green;
   uint8_t blue;
 };
 
+// What a digit cell shows: `frame` frames into the transition from
+// `current` to `next`.
+struct DigitCell {
+  uint8_t current;  //!< digit transitioning out, or shown when equal to `next`
+  uint8_t next;     //!< digit transitioning in
+  uint8_t frame;    //!< frames of the transition shown so far
+};
+
+constexpr DigitCell invalid_cell = {.current = 0xff, .next = 0xff, .frame = 0 };
+
+// What the network core tells the renderer; only the fields of its kind
+// are set.
+struct DisplayMessage {
+  enum Kind : uint8_t { set_timebase, show_text, set_brightness, set_time_zone } kind;
+  ClockDiscipline clock = {};       //!< set_timebase: copy of the disciplined timebase
+  char            text[16] = {};    //!< show_text: text to flash, NUL-terminated
+  uint8_t         brightness = 0;   //!< set_brightness: new panel brightness level
+  uint8_t         time_zone = 0;    //!< set_time_zone: index into time_zones
+};
+
 constexpr int num_digits = 6;
-constexpr int digit_width = 7;
-constexpr int digit_height = 11;
+constexpr int digit_width = digit_font.width('0');
+constexpr int digit_height = digit_font.height;
 constexpr Color font_color = {.red = 200, .green = 190, .blue = 150 };
 constexpr Color colon_color = {.red = 240, .green = 20, .blue = 5 };
 constexpr int extra_space = 3;
-constexpr float initial_brightness = 0.5f;
+constexpr int text_top = 2;
+constexpr uint8_t initial_brightness = 128;
+constexpr int brightness_step = 3;  //!< levels per button poll while held
 constexpr int update_interval_ms = 25;
-constexpr int updates_per_tick = 40;
+constexpr int transition_frames = 11;  //!< a digit flip takes 275 ms
+
+using DigitTransition = CellTransition<digit_width, digit_height, transition_frames>;
 
+// Transition of each digit cell, from the tens of hours to the seconds
+constexpr TransitionStyle digit_transitions[num_digits] = {
+  {Transition::roll, Easing::linear}, {Transition::roll, Easing::linear},
+  {Transition::roll, Easing::linear}, {Transition::roll, Easing::linear},
+  {Transition::roll, Easing::linear}, {Transition::roll, Easing::linear},
+};
 
-bool rtc_set = false;
-PicoGraphics_PenRGB888 graphics(53, 11, nullptr);
-GalacticUnicorn galactic_unicorn;
-uint8_t current_digits[num_digits];
-uint8_t next_digits[num_digits];
-datetime_t shown_datetime;
-int anim_updates_remaining = 0;
 
+// Core 0 runs Wi-Fi, NTP, the RTC and the buttons, core 1 the renderer.
+// All the renderer learns from core 0 goes through the mailbox.
+Mailbox<DisplayMessage, 8> display_mailbox;
+
+// Core 0, besides the ClockCore of ClockApp
+bool timebase_changed = false;    //!< the renderer has yet to get the latest timebase
+uint8_t brightness = initial_brightness;
+bool auto_brightness = true;      //!< follow the light sensor rather than the buttons
+AutoBrightness ambient_light;
+bool brightness_changed = false;  //!< the renderer has yet to get the latest brightness
+bool time_zone_changed = false;   //!< the renderer has yet to get the latest time zone
+bool zone_button_held = false;
+bool buttons_held = false;        //!< polled at the frame rate until released
+
+// Core 0 work of the display, next to that of ClockApp; user_data is the
+// ClockCore.
+async_when_pending_worker_t button_worker;      //!< a button went down
+async_at_time_worker_t button_repeat_worker;    //!< a button is held
+async_at_time_worker_t light_worker;
+async_at_time_worker_t publish_worker;          //!< retries a full mailbox
+
+// Core 1, after main() set up the panel
+PaletteCanvas<GalacticUnicorn::WIDTH, GalacticUnicorn::HEIGHT, 2> graphics;  //!< black, digits, colons, text
+GalacticUnicorn galactic_unicorn;  //!< core 0 only reads its buttons and light sensor
+ClockDiscipline display_clock;    //!< renderer's copy of the timebase
+int64_t shown_second = -1;        //!< Unix second the digits show or roll to
+TimeDigits shown_digits;          //!< local time of shown_second, ticked on each second
+int32_t shown_offset = 0;         //!< UTC offset of shown_digits
+LocalTime display_time;           //!< renderer's copy of the time zone
+DigitCell digit_cells[num_digits];  //!< what the digit cells are to show
+TickLatency tick_latency;
+FramePacer frame_pacer(update_interval_ms * 1000);
+FrameLateness frame_lateness;
+DigitCell drawn_cells[num_digits];  //!< digit cells as currently shown on the panel
+bool display_invalid = true;        //!< frame buffer was drawn over, redraw everything
+TimeShown time_shown;
+
+// Renderer only; core 0 uses post_text().
 void write_text(const std::string_view &text) {
+  display_invalid = true;
   graphics.set_pen(0, 0, 0);
   graphics.clear();
   graphics.set_pen(255, 255, 255);
-  graphics.text(text, Point(0, 2), -1, 0.55);
-  galactic_unicorn.update(&graphics);
+  draw_text(graphics, text_font, 0, text_top, text);
+  graphics.present(galactic_unicorn);
 }
 
-// Called with response of NTP request
-static void ntp_result(NTP_T *state, int status, time_t *result) {
-  if (status == 0 && result) {
-    struct tm *local = localtime(result);
-    printf("got NTP response: %02d/%02d/%04d %02d:%02d:%02d\n", local->tm_mday,
-           local->tm_mon + 1, local->tm_year + 1900, local->tm_hour, local->tm_min,
-           local->tm_sec);
-    datetime_t t = {
-      .year = static_cast<int16_t>(local->tm_year + 1900),
-      .month = static_cast<int8_t>(local->tm_mon + 1),
-      .day = static_cast<int8_t>(local->tm_mday),
-      .hour = static_cast<int8_t>(local->tm_hour),
-      .min = static_cast<int8_t>(local->tm_min),
-      .sec = static_cast<int8_t>(local->tm_sec)
-    };
-    rtc_set_datetime(&t);
-    rtc_set = true;
-    write_text("NTP ok");
+// Hands `message` to the renderer and wakes it; false if the mailbox is full.
+static bool post(const DisplayMessage &message) {
+  if (!display_mailbox.push(message)) {
+    return false;
   }
+  __sev();
+  return true;
+}
+
+// Has the renderer flash `text`, unless it is too far behind to take it.
+static void post_text(const char *text) {
+  DisplayMessage message = {.kind = DisplayMessage::show_text};
+  strncpy(message.text, text, sizeof(message.text) - 1);
+  post(message);
+}
 
-  if (state->ntp_resend_alarm > 0) {
-    cancel_alarm(state->ntp_resend_alarm);
-    state->ntp_resend_alarm = 0;
+// Hands the latest timebase and brightness to the renderer; whatever does
+// not fit into the mailbox now is retried at the frame rate.
+static void publish_display_state(const ClockCore &core) {
+  if (timebase_changed) {
+    DisplayMessage message = {.kind = DisplayMessage::set_timebase};
+    message.clock = core.timebase;
+    timebase_changed = !post(message);
+  }
+  if (brightness_changed) {
+    DisplayMessage message = {.kind = DisplayMessage::set_brightness};
+    message.brightness = brightness;
+    brightness_changed = !post(message);
+  }
+  if (time_zone_changed) {
+    DisplayMessage message = {.kind = DisplayMessage::set_time_zone};
+    message.time_zone = core.time_zone;
+    time_zone_changed = !post(message);
+  }
+  if (timebase_changed || brightness_changed || time_zone_changed) {
+    reschedule(cyw43_arch_async_context(), &publish_worker,
+               make_timeout_time_ms(update_interval_ms));
   }
-  state->ntp_poll_time = make_timeout_time_ms(NTP_POLL_INTERVAL);
-  state->dns_request_sent = false;
 }
 
-static int64_t ntp_failed_handler(alarm_id_t id, void *user_data);
-
-// Submit NTP request via UDP
-static void ntp_request(NTP_T *state) {
-  // cyw43_arch_lwip_begin/end should be used around calls into lwIP to ensure
-  // correct locking. You can omit them if you are in a callback from lwIP. Note
-  // that when using pico_cyw_arch_poll these calls are a no-op and can be
-  // omitted, but it is a good practice to use them in case you switch the
-  // cyw43_arch type later.
-  cyw43_arch_lwip_begin();
-  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NTP_MSG_LEN, PBUF_RAM);
-  uint8_t *req = (uint8_t *)p->payload;
-  memset(req, 0, NTP_MSG_LEN);
-  req[0] = 0x1b;
-  udp_sendto(state->ntp_pcb, p, &state->ntp_server_address, NTP_PORT);
-  pbuf_free(p);
-  cyw43_arch_lwip_end();
+// Left edge of a digit cell; pairs of digits are separated by colons.
+constexpr int digit_left_pos(int digit) {
+  return digit * (digit_width + 1) + (digit / 2) * extra_space;
 }
 
-static int64_t ntp_failed_handler(alarm_id_t id, void *user_data) {
-  NTP_T *state = (NTP_T *)user_data;
-  printf("NTP request failed\n");
-  write_text("NTP failed");
-  ntp_result(state, -1, NULL);
-  return 0;
+static_assert(digit_left_pos(num_digits - 1) + digit_width <= GalacticUnicorn::WIDTH,
+              "digits must fit onto the panel");
+static_assert(digit_height <= GalacticUnicorn::HEIGHT, "digits must fit onto the panel");
+static_assert(digit_font.text_width("0123456789") == 10 * digit_width + 9 * digit_font.spacing,
+              "digit cells have a fixed width");
+static_assert(text_top + text_font.height <= GalacticUnicorn::HEIGHT, "text must fit onto the panel");
+
+static bool same_cell(const DigitCell &a, const DigitCell &b) {
+  return a.current == b.current && a.next == b.next && a.frame == b.frame;
 }
 
-// Callback with DNS response
-static void ntp_dns_found(const char *hostname, const ip_addr_t *ipaddr,
-                          void *arg) {
-  NTP_T *state = (NTP_T *)arg;
-  if (ipaddr) {
-    state->ntp_server_address = *ipaddr;
-    printf("NTP address %s\n", ipaddr_ntoa(ipaddr));
-    ntp_request(state);
-  } else {
-    printf("NTP DNS request failed\n");
-    write_text("DNS failed");
-    ntp_result(state, -1, NULL);
+static void draw_colons() {
+  graphics.set_pen(colon_color.red, colon_color.green, colon_color.blue);
+  for (int hdot = 0; hdot < 2; hdot++) {
+    int x = 2 * (digit_width + 1) * (hdot + 1) + 3 * hdot;
+    for (int vdot = 0; vdot < 2; vdot++) {
+      int y = 2 + 5 * vdot;
+      graphics.rectangle(Rect(x, y, 2, 2));
+    }
   }
 }
 
-// NTP data received
-static void ntp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
-                     const ip_addr_t *addr, u16_t port) {
-  NTP_T *state = (NTP_T *)arg;
-  uint8_t mode = pbuf_get_at(p, 0) & 0x7;
-  uint8_t stratum = pbuf_get_at(p, 1);
-  // Check the result
-  if (ip_addr_cmp(addr, &state->ntp_server_address) && port == NTP_PORT &&
-      p->tot_len == NTP_MSG_LEN && mode == 0x4 && stratum != 0) {
-    uint8_t seconds_buf[4] = {0};
-    pbuf_copy_partial(p, seconds_buf, sizeof(seconds_buf), 40);
-    uint32_t seconds_since_1900 = seconds_buf[0] << 24 | seconds_buf[1] << 16 |
-                                  seconds_buf[2] << 8 | seconds_buf[3];
-    uint32_t seconds_since_1970 = seconds_since_1900 - NTP_DELTA;
-    time_t epoch = seconds_since_1970 + UTC_OFFSET_SECONDS;
-    ntp_result(state, 0, &epoch);
-  } else {
-    printf("invalid NTP response\n");
-    write_text("bad NTP");
-    ntp_result(state, -1, nullptr);
+// Re-rasterises only the digit cells whose content changed since they were
+// last drawn and pushes a frame to the panel only if any cell did.
+void animate_display() {
+  bool dirty = false;
+  if (display_invalid) {
+    graphics.set_pen(0, 0, 0);
+    graphics.clear();
+    draw_colons();
+    for (int digit = 0; digit < num_digits; digit++) {
+      drawn_cells[digit] = invalid_cell;
+    }
+    display_invalid = false;
+    dirty = true;
   }
-  pbuf_free(p);
-}
 
-// Initialisation of NTP client
-static NTP_T *ntp_init(void) {
-  NTP_T *state = (NTP_T *)calloc(1, sizeof(NTP_T));
-  if (!state) {
-    printf("failed to allocate NTP state\n");
-    return NULL;
+  for (int digit = num_digits - 1; digit >= 0; digit--) {
+    const DigitCell &cell = digit_cells[digit];
+    if (same_cell(cell, drawn_cells[digit])) {
+      continue;
+    }
+    int left_pos = digit_left_pos(digit);
+    graphics.set_pen(0, 0, 0);
+    graphics.rectangle(Rect(left_pos, 0, digit_width, digit_height));
+    graphics.set_pen(font_color.red, font_color.green, font_color.blue);
+    DigitTransition::draw(graphics, left_pos, 0, digit_transitions[digit], cell.frame,
+                          digit_font.glyph('0' + cell.current),
+                          digit_font.glyph('0' + cell.next));
+    drawn_cells[digit] = cell;
+    dirty = true;
   }
-  state->ntp_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
-  if (!state->ntp_pcb) {
-    printf("failed to create PCB\n");
-    free(state);
-    return NULL;
+
+  if (dirty) {
+    graphics.present(galactic_unicorn);
   }
-  udp_recv(state->ntp_pcb, ntp_recv, state);
-  return state;
 }
 
-void animate_display() {
-  graphics.set_pen(0, 0, 0);
-  graphics.clear();
-  graphics.set_pen(font_color.red, font_color.green, font_color.blue);
-  for (int digit = num_digits - 1; digit >= 0; digit--) {
-    if (next_digits[digit] == current_digits[digit]) {
-      const char* digit_ptr = &digits[current_digits[digit] * digit_width * digit_height];
-      int left_pos = digit * (digit_width + 1) + (digit / 2) * extra_space;
-      for (int y = 0; y < digit_height; y++) {
-        for (int x = 0; x < digit_width; x++) {
-          if (*digit_ptr == '0') {
-            graphics.pixel(Point(left_pos + x, y));
-          }
-          digit_ptr += 1;
-        }
-      }
-    } else {
-      // animate digit flipping
-      const char* current_digit_ptr = &digits[current_digits[digit] * digit_width * digit_height];
-      const char* next_digit_ptr = &digits[next_digits[digit] * digit_width * digit_height];
-      int left_pos = digit * (digit_width + 1) + (digit / 2) * extra_space;
-      for (int y = 0; y < digit_height; y++) {
-        const char* digit_ptr = (y < anim_updates_remaining)
-          ? (current_digit_ptr + (y + digit_height - anim_updates_remaining) * digit_width)
-          : (next_digit_ptr + (y - anim_updates_remaining) * digit_width);
-        for (int x = 0; x < digit_width; x++) {
-          if (*digit_ptr == '0') {
-            graphics.pixel(Point(left_pos + x, y));
-          }
-          digit_ptr += 1;
-        }
-      }
-    }
+static void button_irq(uint gpio, uint32_t events) {
+  async_context_set_work_pending(cyw43_arch_async_context(), &button_worker);
+}
+
+// Poll the buttons when one goes down, rather than all the time.
+static void enable_button_irqs() {
+  gpio_set_irq_enabled_with_callback(GalacticUnicorn::SWITCH_BRIGHTNESS_UP,
+                                     GPIO_IRQ_EDGE_FALL, true, button_irq);
+  gpio_set_irq_enabled(GalacticUnicorn::SWITCH_BRIGHTNESS_DOWN, GPIO_IRQ_EDGE_FALL, true);
+  gpio_set_irq_enabled(GalacticUnicorn::SWITCH_A, GPIO_IRQ_EDGE_FALL, true);
+}
+
+// Steps to the next time zone each time button A goes down; returns true
+// while it is held, to see it released.
+static bool poll_time_zone_button(ClockCore &core) {
+  bool pressed = galactic_unicorn.is_pressed(galactic_unicorn.SWITCH_A);
+  if (pressed && !zone_button_held) {
+    core.select_time_zone((core.time_zone + 1) % time_zones.size());
+    time_zone_changed = true;
+    printf("time zone: %s\n", time_zones[core.time_zone].name);
   }
-  graphics.set_pen(colon_color.red, colon_color.green, colon_color.blue);
-  for (int hdot = 0; hdot < 2; hdot++) {
-    int x = 2 * (digit_width + 1) * (hdot + 1) + 3 * hdot;
-    for (int vdot = 0; vdot < 2; vdot++) {
-      int y = 2 + 5 * vdot;
-      graphics.rectangle(Rect(x, y, 2, 2));
+  zone_button_held = pressed;
+  return pressed;
+}
+
+// Adjusts the brightness while a button is held; returns true if one is.
+// Either button on its own takes over from the light sensor, both together
+// hand back to it.
+static bool poll_brightness_buttons(ClockCore &core) {
+  bool up = galactic_unicorn.is_pressed(galactic_unicorn.SWITCH_BRIGHTNESS_UP);
+  bool down = galactic_unicorn.is_pressed(galactic_unicorn.SWITCH_BRIGHTNESS_DOWN);
+  if (up && down) {
+    if (!auto_brightness) {
+      printf("brightness: automatic\n");
+      auto_brightness = true;
+      brightness = ambient_light.level();
+      brightness_changed = true;
+      core.journal_dirty = true;
+    }
+  } else if (up || down) {
+    if (auto_brightness) {
+      printf("brightness: manual\n");
+      auto_brightness = false;
     }
+    int level = brightness + (up ? brightness_step : -brightness_step);
+    brightness = static_cast<uint8_t>(level < 0 ? 0 : (level > max_brightness_level
+                                                       ? max_brightness_level : level));
+    brightness_changed = true;
+    core.journal_dirty = true;
   }
-  galactic_unicorn.update(&graphics);
+  return up || down;
 }
 
-// Runs forever
-void run_ntp_main() {
-  NTP_T *state = ntp_init();
-  if (state == nullptr) {
-    return;
+// Takes a light sensor reading, and follows it in automatic mode. The
+// filter keeps running in manual mode, ready for the switch back.
+static void sample_ambient_light() {
+  if (ambient_light.add(galactic_unicorn.light()) && auto_brightness) {
+    brightness = ambient_light.level();
+    brightness_changed = true;
   }
+}
 
-  while (true) {
-    if(galactic_unicorn.is_pressed(galactic_unicorn.SWITCH_BRIGHTNESS_UP)) {
-      galactic_unicorn.adjust_brightness(+0.01);
+// Starts the transitions of the digits that change to show `time`. A
+// transition still running jumps to its end.
+static void show_time(const TimeDigits &time) {
+  for (int digit = 0; digit < num_digits; digit++) {
+    DigitCell &cell = digit_cells[digit];
+    if (time.digits[digit] != cell.next) {
+      cell.current = cell.next;
+      cell.next = time.digits[digit];
+      cell.frame = 0;
+    }
+  }
+}
+
+// Advances the running transitions by one frame and renders it. Returns
+// true while any transition has frames left.
+static bool step_animation() {
+  bool running = false;
+  for (DigitCell &cell : digit_cells) {
+    if (cell.current == cell.next) {
+      continue;
     }
-    if(galactic_unicorn.is_pressed(galactic_unicorn.SWITCH_BRIGHTNESS_DOWN)) {
-      galactic_unicorn.adjust_brightness(-0.01);
+    if (++cell.frame == transition_frames) {
+      cell.current = cell.next;
+      cell.frame = 0;
+    } else {
+      running = true;
     }
+  }
+  animate_display();
+  return running;
+}
 
-    if ((absolute_time_diff_us(get_absolute_time(), state->ntp_poll_time) < 0) &&
-                              !state->dns_request_sent) {
-      // Set alarm in case udp requests are lost
-      state->ntp_resend_alarm =
-          add_alarm_in_ms(NTP_RESEND_INTERVAL, ntp_failed_handler, state, true);
-
-      // cyw43_arch_lwip_begin/end should be used around calls into lwIP to
-      // ensure correct locking. You can omit them if you are in a callback from
-      // lwIP. Note that when using pico_cyw_arch_poll these calls are a no-op
-      // and can be omitted, but it is a good practice to use them in case you
-      // switch the cyw43_arch type later.
-      cyw43_arch_lwip_begin();
-      int err = dns_gethostbyname(NTP_SERVER, &state->ntp_server_address,
-                                  ntp_dns_found, state);
-      cyw43_arch_lwip_end();
-
-      state->dns_request_sent = true;
-      if (err == ERR_OK) {
-        ntp_request(state);  // Cached result
-      } else if (err !=
-                 ERR_INPROGRESS) {  // ERR_INPROGRESS means expect a callback
-        printf("dns request failed\n");
-        ntp_result(state, -1, NULL);
+// Renderer on core 1, runs forever. It keeps its own copy of the timebase
+// and works out the second boundaries from it, so a slow cyw43_arch_poll()
+// or printf() on core 0 holds up neither a second flip nor a frame.
+static void render_main() {
+  multicore_lockout_victim_init();
+  while (true) {
+    DisplayMessage message;
+    while (display_mailbox.pop(&message)) {
+      switch (message.kind) {
+        case DisplayMessage::set_timebase:
+          display_clock = message.clock;
+          break;
+        case DisplayMessage::show_text:
+          write_text(message.text);
+          break;
+        case DisplayMessage::set_brightness:
+          galactic_unicorn.set_brightness(brightness_fraction(message.brightness));
+          graphics.invalidate_panel();
+          graphics.present(galactic_unicorn);
+          break;
+        case DisplayMessage::set_time_zone:
+          display_time.set_zone(time_zones[message.time_zone]);
+          shown_second = -1;  // show the new local time on the next pass
+          break;
       }
     }
 
-    // Periodically poll from main loop (not from a timer interrupt) to check for Wi-Fi
-    // driver or lwIP work that needs to be done.
-    cyw43_arch_poll();
-    // Poll as often as you like, however if you have nothing else to do
-    // you can choose to sleep until either a specified time, or
-    // cyw43_arch_poll() has work to do:
-    if (!rtc_set) {
-      cyw43_arch_wait_for_work_until(
-        state->dns_request_sent ? at_the_end_of_time : state->ntp_poll_time);
-    } else {
-      datetime_t t;
-      rtc_get_datetime(&t);
-      if (t.sec != shown_datetime.sec ||
-          t.min != shown_datetime.min ||
-          t.hour != shown_datetime.hour) {
-        next_digits[0] = t.hour / 10;
-        next_digits[1] = t.hour % 10;
-        next_digits[2] = t.min / 10;
-        next_digits[3] = t.min % 10;
-        next_digits[4] = t.sec / 10;
-        next_digits[5] = t.sec % 10;
-        shown_datetime = t;
-        anim_updates_remaining = digit_height;
+    absolute_time_t next_second = at_the_end_of_time;
+    if (display_clock.synchronised()) {
+      absolute_time_t now = get_absolute_time();
+      uint64_t tick_us = 0;
+      int64_t second = display_clock.utc_us(to_us_since_boot(now)) / 1000000;
+      bool time_changed = second != shown_second;
+      if (time_changed) {
+        // The latency runs from the boundary of the second, which only
+        // means something for a second that followed on the last one.
+        if (second == shown_second + 1) {
+          tick_us = display_clock.local_us_at(second * 1000000, to_us_since_boot(now));
+        }
+        // Within a span of the same UTC offset the digits just tick on.
+        int32_t offset = display_time.offset(second);
+        if (second == shown_second + 1 && offset == shown_offset) {
+          shown_digits.tick();
+        } else {
+          CivilTime t = civil_from_seconds(second + offset);
+          shown_digits.set(t.hour, t.minute, t.second);
+          shown_offset = offset;
+        }
+        shown_second = second;
+        show_time(shown_digits);
+        frame_pacer.start(now);
+      }
+      uint64_t next_us = display_clock.local_us_at((second + 1) * 1000000,
+                                                   to_us_since_boot(now));
+      next_second = from_us_since_boot(next_us > to_us_since_boot(now)
+                                       ? next_us : to_us_since_boot(now) + 1);
+      if (display_invalid && !frame_pacer.running()) {
+        frame_pacer.start(now);
       }
-      if (anim_updates_remaining == 0) {
-        current_digits[0] = next_digits[0];
-        current_digits[1] = next_digits[1];
-        current_digits[2] = next_digits[2];
-        current_digits[3] = next_digits[3];
-        current_digits[4] = next_digits[4];
-        current_digits[5] = next_digits[5];
-      } else {
-        anim_updates_remaining -= 1;
+      if (frame_pacer.due(now)) {
+        frame_lateness.add(frame_pacer.deadline(), now);
+        frame_lateness.report_every(600);
+        bool animating = step_animation();
+        if (time_changed) {
+          time_shown.shown(display_clock);
+        }
+        if (tick_us != 0) {
+          tick_latency.add(tick_us, time_us_64());
+          tick_latency.report_every(60);
+        }
+        if (!animating) {
+          frame_pacer.stop();
+        } else {
+          frame_pacer.advance(get_absolute_time());
+        }
       }
-      animate_display();
-      sleep_ms(update_interval_ms);
     }
+
+    // Sleep until the next second or frame; messages from core 0 come
+    // with an event that ends the wait early.
+    best_effort_wfe_or_timeout(earliest({next_second, frame_pacer.deadline()}));
   }
-  free(state);
 }
 
+// Keeps adjusting at the frame rate while a button is held.
+static void poll_buttons(async_context_t *context, ClockCore &core) {
+  bool held = poll_brightness_buttons(core);
+  held = poll_time_zone_button(core) || held;
+  buttons_held = held;
+  async_context_remove_at_time_worker(context, &button_repeat_worker);
+  if (held) {
+    async_context_add_at_time_worker_in_ms(context, &button_repeat_worker, update_interval_ms);
+  }
+  publish_display_state(core);
+}
 
-int main() {
-  stdio_init_all();
-  galactic_unicorn.init();
-  galactic_unicorn.set_brightness(initial_brightness);
+static void button_work(async_context_t *context, async_when_pending_worker_t *worker) {
+  poll_buttons(context, *(ClockCore *)worker->user_data);
+}
 
-  graphics.set_font("bitmap8");
-  graphics.set_pen(0, 0, 0);
-  graphics.clear();
-  galactic_unicorn.update(&graphics);
+static void button_repeat_work(async_context_t *context, async_at_time_worker_t *worker) {
+  poll_buttons(context, *(ClockCore *)worker->user_data);
+}
 
-  write_text("NTP RTC");
-  sleep_ms(10000);
+static void light_work(async_context_t *context, async_at_time_worker_t *worker) {
+  sample_ambient_light();
+  publish_display_state(*(ClockCore *)worker->user_data);
+  async_context_add_at_time_worker_in_ms(context, worker, AutoBrightness::sample_interval_ms);
+}
 
-  printf("ntp_rtc\n");
-  rtc_init();
-  printf("RTC: initialized\n");
+static void publish_work(async_context_t *context, async_at_time_worker_t *worker) {
+  publish_display_state(*(ClockCore *)worker->user_data);
+}
 
-  if (cyw43_arch_init()) {
-    printf("cyw43: failed to initialise\n");
-    return 1;
+// Display policy of ClockApp for the animated clock: core 1 renders, and
+// core 0 hands it the timebase, status texts and settings through the
+// mailbox, and runs the buttons and the light sensor.
+struct AnimatedDisplay {
+  // Core 1 is not running yet, so its state is set directly.
+  void init(ClockCore &core) {
+    display_time.set_zone(time_zones[core.time_zone]);
+    galactic_unicorn.init();
+    galactic_unicorn.set_brightness(brightness_fraction(brightness));
+
+    graphics.set_pen(0, 0, 0);
+    graphics.clear();
+    graphics.present(galactic_unicorn);
+
+    if (core.time_restored) {
+      // Show the kept time from the first frame and let NTP correct it.
+      display_clock = core.timebase;
+    } else {
+      write_text("NTP RTC");
+    }
+    multicore_launch_core1(render_main);
   }
-  cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-  printf("cyw43: initialized\n");
 
-  cyw43_arch_enable_sta_mode();
-  printf("enabled STA mode, connecting to WiFi...\n");
-  write_text("connecting");
+  void start(ClockCore &core, async_context_t *context) {
+    button_worker.do_work = button_work;
+    button_worker.user_data = &core;
+    button_repeat_worker.do_work = button_repeat_work;
+    button_repeat_worker.user_data = &core;
+    async_context_add_when_pending_worker(context, &button_worker);
+    async_context_set_work_pending(context, &button_worker);
+    light_worker.do_work = light_work;
+    light_worker.user_data = &core;
+    async_context_add_at_time_worker_at(context, &light_worker, get_absolute_time());
+    publish_worker.do_work = publish_work;
+    publish_worker.user_data = &core;
+    enable_button_irqs();
+  }
 
-  if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD,
-                                         CYW43_AUTH_WPA2_AES_PSK, 10000)) {
-    printf("failed to connect\n");
-    return 1;
+  void status(const char *text) { post_text(text); }
+
+  void timebase_updated(ClockCore &core) {
+    timebase_changed = true;
+    publish_display_state(core);
+  }
+
+  // Core 1 works out the seconds on its own copy of the timebase.
+  void tick(ClockCore &core, int64_t second) {}
+
+  bool adjusting() const { return buttons_held; }
+
+  void restore(const ClockState &state) {
+    brightness = state.brightness;
+    auto_brightness = state.auto_brightness != 0;
   }
-  printf("WiFi connected!\n");
-  write_text("Getting NTP");
-  cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-  run_ntp_main();
-  cyw43_arch_deinit();
-  return 0;
+
+  void save(ClockState *state) {
+    state->brightness = brightness;
+    state->auto_brightness = auto_brightness;
+  }
+
+  // Core 1 runs from flash too, so it is held in RAM meanwhile; the
+  // journal is written when it has no frame to render.
+  void begin_flash_write() { multicore_lockout_start_blocking(); }
+  void end_flash_write() { multicore_lockout_end_blocking(); }
+};
+
+int main() {
+  return ClockApp<AnimatedDisplay>::run();
 }
@@ -0,0 +1,124 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef NTP_SELECT_HPP
+#define NTP_SELECT_HPP
+
+#include <cstdint>
+
+#include "ntp_time.hpp"
+
+// Last few samples from one server. Like NTP's clock filter it hands out
+// the sample with the least delay, which suffered least from queueing, with
+// older samples counting as if their delay grew at 2 * 15 ppm of their age.
+class SampleFilter {
+public:
+  static constexpr int size = 8;
+  static constexpr int64_t dispersion_ppb = 15000;  //!< RFC 5905 PHI
+
+  void add(uint64_t local_us, const NtpSample &sample) {
+    entries[next] = Entry{local_us, sample};
+    next = (next + 1) % size;
+    if (count < size) {
+      count++;
+    }
+  }
+
+  void clear() { count = 0; }
+
+  // Best sample brought forward to `now_us`: its offset extrapolated with
+  // the timebase's frequency correction and its delay aged. Stores when
+  // the sample was taken in `taken_us`.
+  bool best(uint64_t now_us, int64_t frequency_ppb, NtpSample *result,
+            uint64_t *taken_us) const {
+    int found = -1;
+    int64_t best_delay = 0;
+    for (int i = 0; i < count; i++) {
+      int64_t delay = aged_delay(entries[i], now_us);
+      if (found < 0 || delay < best_delay) {
+        found = i;
+        best_delay = delay;
+      }
+    }
+    if (found < 0) {
+      return false;
+    }
+    int64_t age_us = static_cast<int64_t>(now_us - entries[found].local_us);
+    result->offset_us = entries[found].sample.offset_us + age_us * frequency_ppb / 1000000000;
+    result->delay_us = best_delay;
+    *taken_us = entries[found].local_us;
+    return true;
+  }
+
+private:
+  struct Entry {
+    uint64_t  local_us;  //!< time_us_64() when the reply came in
+    NtpSample sample;
+  };
+
+  static int64_t aged_delay(const Entry &entry, uint64_t now_us) {
+    int64_t age_us = static_cast<int64_t>(now_us - entry.local_us);
+    return entry.sample.delay_us + 2 * age_us * dispersion_ppb / 1000000000;
+  }
+
+  Entry entries[size];
+  int   count = 0;
+  int   next = 0;
+};
+
+// Whether the true offset can lie within `sample`'s correctness interval,
+// offset +/- delay / 2, at `offset_us`.
+constexpr bool ntp_interval_contains(const NtpSample &sample, int64_t offset_us) {
+  return sample.offset_us - sample.delay_us / 2 <= offset_us &&
+         offset_us <= sample.offset_us + sample.delay_us / 2;
+}
+
+// Marzullo's intersection algorithm as in NTP's clock selection: finds the
+// offset contained in the most correctness intervals. The samples whose
+// interval contains it are the truechimers, the others falsetickers. Marks
+// the truechimers and returns their number, or 0 if they are no majority.
+inline int ntp_select_truechimers(const NtpSample *samples, int count, bool *truechimer) {
+  int best_count = 0;
+  int64_t best_offset = 0;
+  // The deepest overlap always starts at the lower end of some interval.
+  for (int i = 0; i < count; i++) {
+    int64_t offset_us = samples[i].offset_us - samples[i].delay_us / 2;
+    int n = 0;
+    for (int j = 0; j < count; j++) {
+      n += ntp_interval_contains(samples[j], offset_us);
+    }
+    if (n > best_count) {
+      best_count = n;
+      best_offset = offset_us;
+    }
+  }
+  if (2 * best_count <= count) {
+    return 0;
+  }
+  for (int i = 0; i < count; i++) {
+    truechimer[i] = ntp_interval_contains(samples[i], best_offset);
+  }
+  return best_count;
+}
+
+// Combines the truechimers into one sample: the mean of their offsets and
+// the least of their delays.
+inline NtpSample ntp_combine(const NtpSample *samples, int count, const bool *truechimer) {
+  int64_t offset_sum = 0;
+  int n = 0;
+  NtpSample result = {0, 0};
+  for (int i = 0; i < count; i++) {
+    if (truechimer[i]) {
+      offset_sum += samples[i].offset_us;
+      if (n == 0 || samples[i].delay_us < result.delay_us) {
+        result.delay_us = samples[i].delay_us;
+      }
+      n++;
+    }
+  }
+  if (n > 0) {
+    result.offset_us = offset_sum / n;
+  }
+  return result;
+}
+
+#endif  // NTP_SELECT_HPP
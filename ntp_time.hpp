@@ -0,0 +1,66 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef NTP_TIME_HPP
+#define NTP_TIME_HPP
+
+#include <cstdint>
+
+#define NTP_DELTA 2208988800  // seconds between 1 Jan 1900 and 1 Jan 1970
+
+// Unix time known to have passed, 1 Jan 2023; see ntp_to_unix_us().
+constexpr int64_t ntp_default_pivot_s = 1672531200;
+
+// NTP timestamps are 32.32 fixed point: seconds since the start of the
+// current era in the upper half and the binary fraction of a second in the
+// lower half. Era 0 began on 1 Jan 1900, era 1 begins in February 2036.
+// The era is taken to be the one that puts the timestamp within 68 years
+// of `pivot_s`, a Unix time believed to be close.
+constexpr int64_t ntp_to_unix_us(uint64_t timestamp, int64_t pivot_s = ntp_default_pivot_s) {
+  uint32_t pivot_ntp_s = static_cast<uint32_t>(pivot_s + NTP_DELTA);
+  int32_t from_pivot_s = static_cast<int32_t>(static_cast<uint32_t>(timestamp >> 32) - pivot_ntp_s);
+  int64_t seconds = pivot_s + from_pivot_s;
+  uint64_t fraction_us = ((timestamp & 0xffffffff) * 1000000 + 0x80000000) >> 32;
+  return seconds * 1000000 + static_cast<int64_t>(fraction_us);
+}
+
+// The era is dropped, as on the wire. Times before 1970 round down to the
+// second below like any other.
+constexpr uint64_t unix_us_to_ntp(int64_t unix_us) {
+  int64_t seconds = unix_us / 1000000;
+  int64_t micros = unix_us % 1000000;
+  if (micros < 0) {
+    seconds--;
+    micros += 1000000;
+  }
+  uint64_t fraction = (static_cast<uint64_t>(micros) << 32) / 1000000;
+  return static_cast<uint64_t>(seconds + NTP_DELTA) << 32 | fraction;
+}
+
+static_assert(ntp_to_unix_us(uint64_t(NTP_DELTA) << 32 | 0x80000000) == 500000,
+              "half a second past the Unix epoch");
+static_assert(ntp_to_unix_us(unix_us_to_ntp(1700000000123456)) == 1700000000123456,
+              "microseconds survive a round trip");
+static_assert(ntp_to_unix_us(unix_us_to_ntp(2240524800000000)) == 2240524800000000,
+              "1 Jan 2041 lies in era 1");
+static_assert(ntp_to_unix_us(0, 2240524800) == 2085978496000000,
+              "timestamp 0 is the start of era 1 seen from 2041");
+static_assert(ntp_to_unix_us(unix_us_to_ntp(-1500000)) == -1500000,
+              "times before 1970 survive a round trip");
+
+// Result of one request/reply exchange, computed from its four timestamps
+// as in RFC 5905: t1 client transmit, t2 server receive, t3 server transmit
+// and t4 client receive. The client's timestamps are time_us_64() values,
+// so the offset maps time_us_64() to Unix time in microseconds.
+struct NtpSample {
+  int64_t offset_us;  //!< server clock minus client clock
+  int64_t delay_us;   //!< round-trip delay without the server's processing time
+};
+
+constexpr NtpSample ntp_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+  return NtpSample{
+    .offset_us = ((t2 - t1) + (t3 - t4)) / 2,
+    .delay_us = (t4 - t1) - (t3 - t2)
+  };
+}
+
+#endif  // NTP_TIME_HPP
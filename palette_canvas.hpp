@@ -0,0 +1,135 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef PALETTE_CANVAS_HPP
+#define PALETTE_CANVAS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "galactic_unicorn.hpp"
+
+// PicoGraphics target for the panel that keeps a palette index of `Bits`
+// bits per pixel rather than an RGB888 colour, and sends the panel only
+// what changed. Two bits hold the four colours of the animated clock, one
+// bit the black and white of the text clock.
+//
+// Drawing goes into the back buffer. present() compares it with the front
+// buffer, which holds what the panel shows, and hands the palette colour of
+// each changed pixel to the driver, which converts it into the panel's
+// bitplanes. A frame thus costs in proportion to the pixels that moved, not
+// a conversion of all of them, and the panel never sees a frame that is
+// still being drawn. The driver scales colours by the brightness as they
+// come in, so after a brightness change invalidate_panel() has the next
+// present() send every pixel again.
+template <int Width, int Height, int Bits>
+class PaletteCanvas : public pimoroni::PicoGraphics {
+  static_assert(Bits == 1 || Bits == 2 || Bits == 4, "pixels are packed into whole bytes");
+
+public:
+  struct Color {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+  };
+
+  static constexpr int palette_size = 1 << Bits;
+  static constexpr int pixels_per_byte = 8 / Bits;
+  static constexpr size_t buffer_size = (Width * Height + pixels_per_byte - 1) / pixels_per_byte;
+
+  PaletteCanvas() : PicoGraphics(Width, Height, back) {
+    pen_type = Bits == 1 ? PEN_1BIT : (Bits == 2 ? PEN_P2 : PEN_P4);
+  }
+
+  // Pens are palette entries, added on the first use of a colour. Once the
+  // palette is full, further colours get the closest entry.
+  int create_pen(uint8_t r, uint8_t g, uint8_t b) override {
+    int closest = 0;
+    int closest_distance = INT32_MAX;
+    for (int i = 0; i < colors; i++) {
+      int dr = palette[i].red - r;
+      int dg = palette[i].green - g;
+      int db = palette[i].blue - b;
+      int distance = dr * dr + dg * dg + db * db;
+      if (distance < closest_distance) {
+        closest = i;
+        closest_distance = distance;
+      }
+    }
+    if (closest_distance == 0 || colors == palette_size) {
+      return closest;
+    }
+    palette[colors] = Color{r, g, b};
+    return colors++;
+  }
+
+  void set_pen(uint c) override { use_pen(c < static_cast<uint>(colors) ? c : 0); }
+  void set_pen(uint8_t r, uint8_t g, uint8_t b) override { use_pen(create_pen(r, g, b)); }
+
+  void set_pixel(const pimoroni::Point &p) override {
+    put(p.y * Width + p.x);
+  }
+
+  void set_pixel_span(const pimoroni::Point &p, uint l) override {
+    int i = p.y * Width + p.x;
+    for (; l > 0 && i % pixels_per_byte != 0; l--) {
+      put(i++);
+    }
+    memset(&back[i / pixels_per_byte], pen_fill, l / pixels_per_byte);
+    i += l / pixels_per_byte * pixels_per_byte;
+    for (l %= pixels_per_byte; l > 0; l--) {
+      put(i++);
+    }
+  }
+
+  void invalidate_panel() { repaint = true; }
+
+  // Sends the pixels drawn differently since the last call to the panel.
+  void present(pimoroni::GalacticUnicorn &panel) {
+    for (size_t byte = 0; byte < buffer_size; byte++) {
+      uint8_t drawn = back[byte];
+      uint8_t shown = front[byte];
+      if (drawn == shown && !repaint) {
+        continue;
+      }
+      for (int k = 0; k < pixels_per_byte; k++) {
+        int i = static_cast<int>(byte) * pixels_per_byte + k;
+        int index = (drawn >> (k * Bits)) & mask;
+        if (i < Width * Height && (repaint || index != ((shown >> (k * Bits)) & mask))) {
+          const Color &color = palette[index];
+          panel.set_pixel(i % Width, i / Width, color.red, color.green, color.blue);
+        }
+      }
+      front[byte] = drawn;
+    }
+    repaint = false;
+  }
+
+private:
+  static constexpr uint8_t mask = palette_size - 1;
+
+  void use_pen(int index) {
+    pen = static_cast<uint8_t>(index);
+    pen_fill = 0;
+    for (int k = 0; k < pixels_per_byte; k++) {
+      pen_fill |= pen << (k * Bits);
+    }
+  }
+
+  void put(int i) {
+    int shift = (i % pixels_per_byte) * Bits;
+    uint8_t &byte = back[i / pixels_per_byte];
+    byte = static_cast<uint8_t>((byte & ~(mask << shift)) | (pen << shift));
+  }
+
+  Color   palette[palette_size] = {};  //!< entry 0 is black, which the panel starts with
+  int     colors = 1;
+  uint8_t pen = 0;
+  uint8_t pen_fill = 0;                //!< byte of pixels all in the pen's colour
+  uint8_t back[buffer_size] = {};      //!< frame being drawn
+  uint8_t front[buffer_size] = {};     //!< frame on the panel
+  bool    repaint = true;              //!< send all pixels on the next present()
+};
+
+#endif  // PALETTE_CANVAS_HPP
@@ -0,0 +1,83 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cinttypes>
+#include <initializer_list>
+
+#include "pico/async_context.h"
+#include "pico/stdlib.h"
+
+// Earliest of a set of deadlines; the main loop sleeps until this point.
+inline absolute_time_t earliest(std::initializer_list<absolute_time_t> deadlines) {
+  absolute_time_t result = at_the_end_of_time;
+  for (absolute_time_t deadline : deadlines) {
+    if (absolute_time_diff_us(deadline, result) > 0) {
+      result = deadline;
+    }
+  }
+  return result;
+}
+
+// Has the at-time `worker` of `context` run at `time`, in place of when it
+// was due before, if it was.
+inline void reschedule(async_context_t *context, async_at_time_worker_t *worker,
+                       absolute_time_t time) {
+  async_context_remove_at_time_worker(context, worker);
+  async_context_add_at_time_worker_at(context, worker, time);
+}
+
+// Fixed-timestep frame pacing: frames are due at start + n * interval no
+// matter how long rendering took. A frame that is more than one interval
+// late re-anchors the sequence rather than catching up in a burst.
+class FramePacer {
+public:
+  explicit constexpr FramePacer(uint32_t interval_us) : interval_us(interval_us) {}
+
+  void start(absolute_time_t now) { next_frame = now; }
+  void stop() { next_frame = at_the_end_of_time; }
+  bool running() const { return !is_at_the_end_of_time(next_frame); }
+  bool due(absolute_time_t now) const { return absolute_time_diff_us(next_frame, now) >= 0; }
+  absolute_time_t deadline() const { return next_frame; }
+
+  // Schedules the frame after the one that was just rendered.
+  void advance(absolute_time_t now) {
+    next_frame = delayed_by_us(next_frame, interval_us);
+    if (absolute_time_diff_us(now, next_frame) < 0) {
+      next_frame = delayed_by_us(now, interval_us);
+    }
+  }
+
+private:
+  uint32_t interval_us;
+  absolute_time_t next_frame = at_the_end_of_time;
+};
+
+// How late frames were rendered against their FramePacer deadline,
+// summarised over a number of frames.
+struct FrameLateness {
+  uint32_t count = 0;
+  uint32_t total_us = 0;
+  uint32_t max_us = 0;
+
+  void add(absolute_time_t deadline, absolute_time_t rendered) {
+    uint32_t lateness_us = static_cast<uint32_t>(absolute_time_diff_us(deadline, rendered));
+    count++;
+    total_us += lateness_us;
+    if (lateness_us > max_us) {
+      max_us = lateness_us;
+    }
+  }
+
+  // Prints and restarts the summary once `frames` frames were collected.
+  void report_every(uint32_t frames) {
+    if (count >= frames) {
+      printf("frame lateness: avg %" PRIu32 " us, max %" PRIu32 " us\n",
+             total_us / count, max_us);
+      *this = FrameLateness();
+    }
+  }
+};
+
+#endif  // SCHEDULER_HPP
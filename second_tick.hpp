@@ -0,0 +1,131 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef SECOND_TICK_HPP
+#define SECOND_TICK_HPP
+
+#include <cinttypes>
+
+#include "clock_discipline.hpp"
+#include "pico/stdlib.h"
+
+// Per-second tick on the whole seconds of the disciplined timebase. A
+// hardware alarm is armed for the next second and re-arms itself from the
+// timebase's current rate each time it fires, so slewing and frequency
+// corrections move the ticks smoothly and the main loop is woken right at
+// each second boundary.
+class SecondTick {
+public:
+  // (Re)starts the tick on `timebase`, and raises a first tick right away
+  // so that the current second gets shown.
+  static void start(const ClockDiscipline &timebase) {
+    if (alarm > 0) {
+      cancel_alarm(alarm);
+    }
+    source = &timebase;
+    uint64_t now = time_us_64();
+    int64_t utc_us = timebase.utc_us(now);
+    tick_second = utc_us / 1000000;
+    tick_us = now;
+    tick_on_second = false;
+    tick = true;
+    if (notify) {
+      notify();
+    }
+    target_us = timebase.local_us_at((tick_second + 1) * 1000000, now);
+    alarm = add_alarm_at(from_us_since_boot(target_us), irq, nullptr, true);
+  }
+
+  // Has `callback` called with each tick, from the alarm interrupt, to wake
+  // whatever takes the ticks.
+  static void on_tick(void (*callback)()) { notify = callback; }
+
+  static bool pending() { return tick; }
+
+  // Whether the pending tick came right on its second from the alarm,
+  // rather than from start().
+  static bool on_second() { return tick_on_second; }
+
+  // Consumes the pending tick; returns the time_us_64() of its interrupt
+  // and stores the Unix second it started in `second`.
+  static uint64_t take(int64_t *second) {
+    tick = false;
+    *second = tick_second;
+    return tick_us;
+  }
+
+private:
+  static int64_t irq(alarm_id_t id, void *user_data) {
+    tick_us = time_us_64();
+    tick_second = tick_second + 1;
+    tick_on_second = true;
+    tick = true;
+    if (notify) {
+      notify();
+    }
+    uint64_t next_us = source->local_us_at((tick_second + 1) * 1000000, tick_us);
+    if (next_us <= target_us) {
+      next_us = target_us + 1;  // 0 would cancel the alarm
+    }
+    // Negative: relative to when this alarm was due, so lateness does not add up.
+    int64_t reschedule_us = -static_cast<int64_t>(next_us - target_us);
+    target_us = next_us;
+    return reschedule_us;
+  }
+
+  inline static const ClockDiscipline *source = nullptr;
+  inline static void (*notify)() = nullptr;
+  inline static alarm_id_t alarm = 0;
+  inline static uint64_t target_us = 0;   //!< time_us_64() the alarm is due at
+  inline static volatile bool tick = false;
+  inline static volatile uint64_t tick_us = 0;
+  inline static volatile int64_t tick_second = 0;
+  inline static volatile bool tick_on_second = false;
+};
+
+// Latency from the boundary of a second until the frame showing it went
+// to the panel, summarised over a number of ticks.
+struct TickLatency {
+  uint32_t count = 0;
+  uint32_t total_us = 0;
+  uint32_t max_us = 0;
+
+  void add(uint64_t tick_us, uint64_t shown_us) {
+    uint32_t latency_us = static_cast<uint32_t>(shown_us - tick_us);
+    count++;
+    total_us += latency_us;
+    if (latency_us > max_us) {
+      max_us = latency_us;
+    }
+  }
+
+  // Prints and restarts the summary once `ticks` ticks were collected.
+  void report_every(uint32_t ticks) {
+    if (count >= ticks) {
+      printf("second tick latency: avg %" PRIu32 " us, max %" PRIu32 " us\n",
+             total_us / count, max_us);
+      *this = TickLatency();
+    }
+  }
+};
+
+// Logs when the time first went to the panel after power-on: the time kept
+// from before, and the time an NTP sample confirmed.
+struct TimeShown {
+  bool kept = false;
+  bool confirmed = false;
+
+  void shown(const ClockDiscipline &timebase) {
+    if (confirmed) {
+      return;
+    }
+    if (timebase.confirmed()) {
+      printf("time shown %" PRIu64 " ms after power-on\n", time_us_64() / 1000);
+      confirmed = true;
+    } else if (!kept) {
+      printf("kept time shown %" PRIu64 " ms after power-on\n", time_us_64() / 1000);
+      kept = true;
+    }
+  }
+};
+
+#endif  // SECOND_TICK_HPP
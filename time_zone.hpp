@@ -0,0 +1,198 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef TIME_ZONE_HPP
+#define TIME_ZONE_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "civil_time.hpp"
+
+// Time zones as tables of the rules in force today, compiled from IANA
+// tzdata at build time by tools/tz_compiler (see cmake/time_zones.cmake).
+// A zone has a fixed offset from UTC or two yearly changes of offset, such
+// as the start and end of daylight saving time. Past changes are not kept,
+// so local times before the current rules came in are not historical.
+
+// Day of the month a rule applies on
+enum class DayRule : uint8_t {
+  fixed,         //!< `day`, as in "Oct 31"
+  last,          //!< the last `weekday` of the month, as in "lastSun"
+  on_or_after,   //!< the first `weekday` on or after `day`, as in "Sun>=8"
+  on_or_before,  //!< the last `weekday` on or before `day`, as in "Sun<=25"
+};
+
+// Clock the time of day of a rule is given in
+enum class TimeBase : uint8_t {
+  wall,       //!< local time as shown until the change
+  standard,   //!< local standard time
+  universal,  //!< UTC
+};
+
+// Yearly change of a zone's offset
+struct ZoneRule {
+  uint8_t  month;              //!< 1 to 12
+  uint8_t  day;                //!< 1 to 31, not used by DayRule::last
+  uint8_t  weekday;            //!< 0 is Sunday, not used by DayRule::fixed
+  DayRule  day_rule;
+  int32_t  at;                 //!< seconds into the day
+  TimeBase at_base;
+  int32_t  offset;             //!< seconds east of UTC from then on
+  char     abbreviation[8];    //!< such as "CEST", from then on
+};
+
+struct TimeZone {
+  const char *name;               //!< tzdata name, such as "Europe/Zurich"
+  int32_t     standard_offset;    //!< seconds east of UTC
+  int32_t     offset;             //!< seconds east of UTC without rules
+  char        abbreviation[8];    //!< without rules
+  uint8_t     num_rules;          //!< 0 or 2
+  ZoneRule    rules[2];
+
+  // Unix second at which `rule` changes the offset in `year`, from
+  // `offset_before`.
+  constexpr int64_t change(const ZoneRule &rule, int32_t year, int32_t offset_before) const {
+    int64_t day = days_from_civil(year, rule.month, rule.day_rule == DayRule::last ? 1 : rule.day);
+    switch (rule.day_rule) {
+      case DayRule::fixed:
+        break;
+      case DayRule::last:
+        day = (rule.month == 12 ? days_from_civil(year + 1, 1, 1)
+                                : days_from_civil(year, rule.month + 1u, 1)) - 1;
+        day -= (weekday_from_days(day) + 7 - rule.weekday) % 7;
+        break;
+      case DayRule::on_or_after:
+        day += (rule.weekday + 7 - weekday_from_days(day)) % 7;
+        break;
+      case DayRule::on_or_before:
+        day -= (weekday_from_days(day) + 7 - rule.weekday) % 7;
+        break;
+    }
+    int64_t local = day * 86400 + rule.at;
+    switch (rule.at_base) {
+      case TimeBase::wall:
+        return local - offset_before;
+      case TimeBase::standard:
+        return local - standard_offset;
+      case TimeBase::universal:
+        break;
+    }
+    return local;
+  }
+};
+
+// Identifies a zone across builds whose tables differ: FNV-1a of its name
+constexpr uint32_t time_zone_id(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (; *name; name++) {
+    hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+  }
+  return hash;
+}
+
+template <int Count>
+struct TimeZoneTable {
+  static_assert(Count >= 1, "a clock needs a time zone");
+
+  TimeZone zones[Count];
+
+  static constexpr int size() { return Count; }
+
+  const TimeZone &operator[](int i) const { return zones[i]; }
+
+  // Index of the zone called `name`, or -1
+  int find(const char *name) const {
+    for (int i = 0; i < Count; i++) {
+      if (strcmp(zones[i].name, name) == 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Index of the zone with time_zone_id() `id`, or -1
+  int find(uint32_t id) const {
+    for (int i = 0; i < Count; i++) {
+      if (time_zone_id(zones[i].name) == id) {
+        return i;
+      }
+    }
+    return -1;
+  }
+};
+
+// UTC offset of a zone with the span of time it holds for cached, from the
+// change before to the change after. Converting a time within the span,
+// as a clock does all but twice a year, costs one comparison; only a time
+// outside it works the changes out again. Not shared between cores.
+class LocalTime {
+public:
+  void set_zone(const TimeZone &zone) {
+    this->zone = &zone;
+    span = 0;
+  }
+
+  const TimeZone &time_zone() const { return *zone; }
+
+  // Offset of local time from UTC at Unix second `second`, in seconds
+  int32_t offset(int64_t second) {
+    if (static_cast<uint64_t>(second) - static_cast<uint64_t>(from) >= span) {
+      find_span(second);
+    }
+    return current_offset;
+  }
+
+  // Zone abbreviation at Unix second `second`, such as "CET"
+  const char *abbreviation(int64_t second) {
+    offset(second);
+    return current_abbreviation;
+  }
+
+  CivilTime civil(int64_t second) { return civil_from_seconds(second + offset(second)); }
+
+private:
+  void find_span(int64_t second) {
+    if (zone->num_rules == 0) {
+      from = INT64_MIN;
+      span = UINT64_MAX;
+      current_offset = zone->offset;
+      current_abbreviation = zone->abbreviation;
+      return;
+    }
+    // The changes of the years around `second`, in order. Each rule's
+    // change starts from the offset of the other.
+    struct Change {
+      int64_t second;
+      const ZoneRule *rule;
+    } changes[6];
+    int32_t year = civil_from_seconds(second + zone->standard_offset).year;
+    int count = 0;
+    for (int32_t y = year - 1; y <= year + 1; y++) {
+      for (int r = 0; r < 2; r++) {
+        Change change = {zone->change(zone->rules[r], y, zone->rules[1 - r].offset),
+                         &zone->rules[r]};
+        int i = count++;
+        for (; i > 0 && changes[i - 1].second > change.second; i--) {
+          changes[i] = changes[i - 1];
+        }
+        changes[i] = change;
+      }
+    }
+    int last = 0;
+    while (last + 1 < count - 1 && changes[last + 1].second <= second) {
+      last++;
+    }
+    from = changes[last].second;
+    span = static_cast<uint64_t>(changes[last + 1].second - from);
+    current_offset = changes[last].rule->offset;
+    current_abbreviation = changes[last].rule->abbreviation;
+  }
+
+  const TimeZone *zone = nullptr;
+  int64_t     from = 0;           //!< first second of the cached span
+  uint64_t    span = 0;           //!< seconds in the span, 0 for none
+  int32_t     current_offset = 0;
+  const char *current_abbreviation = "";
+};
+
+#endif  // TIME_ZONE_HPP
@@ -0,0 +1,343 @@
+// Build-time font compiler: turns a font source into a header with a
+// constexpr GlyphAtlas (see glyph.hpp) of the printable ASCII characters.
+//
+//   font_compiler <source> <header> <name> [<glyphs>]
+//
+// <name> becomes the name of the atlas; <glyphs>, if given, limits it to
+// those characters, each of which the source must then define. Sources
+// ending in .bdf are read as BDF (Glyph Bitmap Distribution Format 2.1),
+// anything else as ASCII art:
+//
+//   # comment
+//   height 9          rows of every glyph, from the top of the cell
+//   spacing 1         columns between two glyphs
+//   kern AV -1        adjustment of the gap between `A` and a following `V`
+//   glyph A           followed by `height` rows; `0` is lit, `.` is not
+//   .000.
+//   ...
+//
+// `glyph space` defines the space character. All rows of a glyph have the
+// same length, which is its width, at most 8 columns.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int first_char = ' ';
+constexpr int last_char = '~';
+constexpr int max_width = 8;
+constexpr int max_height = 32;
+
+struct Glyph {
+  int width = 0;
+  std::vector<uint8_t> rows;  //!< bit x is column x
+};
+
+struct Kern {
+  char left;
+  char right;
+  int adjust;
+};
+
+struct Font {
+  int height = 0;
+  int spacing = 0;
+  std::map<char, Glyph> glyphs;
+  std::vector<Kern> kerns;
+};
+
+std::string source_name;
+int line_number = 0;
+
+bool fail(const char *message, const std::string &detail = "") {
+  std::string where = source_name;
+  if (line_number > 0) {
+    where += ":" + std::to_string(line_number);
+  }
+  fprintf(stderr, "%s: %s%s%s\n", where.c_str(), message, detail.empty() ? "" : ": ",
+          detail.c_str());
+  return false;
+}
+
+bool printable(int c) { return c >= first_char && c <= last_char; }
+
+bool read_lines(const std::string &path, std::vector<std::string> *lines) {
+  std::ifstream in(path);
+  if (!in) {
+    return fail("cannot open font source");
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    lines->push_back(line);
+  }
+  return true;
+}
+
+bool parse_art(const std::vector<std::string> &lines, Font *font) {
+  for (size_t i = 0; i < lines.size(); i++) {
+    line_number = static_cast<int>(i) + 1;
+    const std::string &line = lines[i];
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string keyword;
+    fields >> keyword;
+    if (keyword == "height" || keyword == "spacing") {
+      int value = -1;
+      fields >> value;
+      if (value < 0 || (keyword == "height" && (value < 1 || value > max_height))) {
+        return fail("bad value", line);
+      }
+      (keyword == "height" ? font->height : font->spacing) = value;
+    } else if (keyword == "kern") {
+      std::string pair;
+      int adjust = 0;
+      if (!(fields >> pair >> adjust) || pair.size() != 2) {
+        return fail("expected `kern <left><right> <adjustment>`", line);
+      }
+      font->kerns.push_back(Kern{pair[0], pair[1], adjust});
+    } else if (keyword == "glyph") {
+      std::string name = line.size() > 6 ? line.substr(6) : "";
+      char c = name == "space" ? ' ' : name[0];
+      if ((name.size() != 1 && name != "space") || !printable(c)) {
+        return fail("expected `glyph <character>`", line);
+      }
+      if (font->height == 0) {
+        return fail("glyph before height");
+      }
+      if (font->glyphs.count(c)) {
+        return fail("glyph defined twice", name);
+      }
+      Glyph glyph;
+      for (int y = 0; y < font->height; y++) {
+        line_number++;
+        if (++i >= lines.size()) {
+          return fail("glyph is missing rows", name);
+        }
+        const std::string &row = lines[i];
+        if (y == 0) {
+          glyph.width = static_cast<int>(row.size());
+        }
+        if (row.empty() || static_cast<int>(row.size()) != glyph.width ||
+            glyph.width > max_width) {
+          return fail("rows must be 1 to 8 columns, all of the same width", name);
+        }
+        uint8_t bits = 0;
+        for (int x = 0; x < glyph.width; x++) {
+          if (row[x] == '0') {
+            bits |= static_cast<uint8_t>(1u << x);
+          } else if (row[x] != '.') {
+            return fail("rows consist of `0` and `.`", row);
+          }
+        }
+        glyph.rows.push_back(bits);
+      }
+      font->glyphs[c] = glyph;
+    } else {
+      return fail("unknown keyword", keyword);
+    }
+  }
+  return true;
+}
+
+// Reads the printable ASCII glyphs of a BDF font. The cell spans the font's
+// ascent and descent; each glyph is as wide as its advance (DWIDTH), so the
+// spacing is already in the glyphs and the atlas gets none.
+bool parse_bdf(const std::vector<std::string> &lines, Font *font) {
+  int ascent = -1;
+  int descent = -1;
+  int encoding = -1;
+  int advance = 0;
+  int box_width = 0, box_height = 0, box_x = 0, box_y = 0;
+  int bitmap_row = -1;  //!< row of the glyph's bitmap being read, or -1
+  Glyph glyph;
+  for (size_t i = 0; i < lines.size(); i++) {
+    line_number = static_cast<int>(i) + 1;
+    std::istringstream fields(lines[i]);
+    std::string keyword;
+    fields >> keyword;
+    if (bitmap_row >= 0 && keyword != "ENDCHAR") {
+      int bytes = static_cast<int>(keyword.size()) / 2;
+      if (8 * bytes > static_cast<int>(8 * sizeof(unsigned long))) {
+        return fail("bitmap row too long", keyword);
+      }
+      if (box_width > 8 * bytes) {
+        return fail("bitmap row narrower than the BBX", keyword);
+      }
+      unsigned long bits = strtoul(keyword.c_str(), nullptr, 16);
+      int y = ascent - box_y - box_height + bitmap_row++;
+      for (int x = 0; x < box_width; x++) {
+        if (bits >> (8 * bytes - 1 - x) & 1) {
+          int column = box_x + x;
+          if (y < 0 || y >= font->height || column < 0 || column >= max_width) {
+            return fail("glyph pixel outside of an 8-column cell");
+          }
+          glyph.rows[y] |= static_cast<uint8_t>(1u << column);
+        }
+      }
+    } else if (keyword == "FONT_ASCENT") {
+      fields >> ascent;
+    } else if (keyword == "FONT_DESCENT") {
+      fields >> descent;
+    } else if (keyword == "STARTCHAR") {
+      if (ascent < 0 || descent < 0 || ascent + descent < 1 ||
+          ascent + descent > max_height) {
+        return fail("missing or bad FONT_ASCENT and FONT_DESCENT");
+      }
+      font->height = ascent + descent;
+      encoding = -1;
+      advance = 0;
+      box_width = box_height = box_x = box_y = 0;
+    } else if (keyword == "ENCODING") {
+      fields >> encoding;
+    } else if (keyword == "DWIDTH") {
+      fields >> advance;
+    } else if (keyword == "BBX") {
+      fields >> box_width >> box_height >> box_x >> box_y;
+    } else if (keyword == "BITMAP") {
+      glyph = Glyph();
+      glyph.width = advance;
+      glyph.rows.assign(font->height, 0);
+      bitmap_row = 0;
+    } else if (keyword == "ENDCHAR") {
+      bitmap_row = -1;
+      if (!printable(encoding)) {
+        continue;  // not in the atlas
+      }
+      if (glyph.width < 1 || glyph.width > max_width) {
+        return fail("advance must be 1 to 8 columns");
+      }
+      font->glyphs[static_cast<char>(encoding)] = glyph;
+    }
+  }
+  return true;
+}
+
+std::string char_literal(char c) {
+  if (c == '\'' || c == '\\') {
+    return std::string("'\\") + c + "'";
+  }
+  return std::string("'") + c + "'";
+}
+
+bool write_header(const Font &font, const std::string &path, const std::string &name) {
+  std::vector<char> chars;
+  for (const auto &entry : font.glyphs) {
+    chars.push_back(entry.first);
+  }
+  std::map<char, int> index;
+  for (size_t i = 0; i < chars.size(); i++) {
+    index[chars[i]] = static_cast<int>(i);
+  }
+  std::vector<Kern> kerns;
+  for (const Kern &kern : font.kerns) {
+    if (index.count(kern.left) && index.count(kern.right)) {
+      kerns.push_back(kern);
+    }
+  }
+
+  std::string guard;
+  for (char c : name) {
+    guard += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
+  guard += "_HPP";
+
+  std::ostringstream out;
+  out << "// Generated by font_compiler from " << source_name << "; do not edit.\n\n"
+      << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+      << "#include \"glyph.hpp\"\n\n"
+      << "constexpr GlyphAtlas<" << chars.size() << ", " << font.height << ", "
+      << kerns.size() << "> " << name << " = {\n"
+      << "  " << font.spacing << ",  // spacing\n  {  // glyph of each character from ' ' to '~'";
+  // Characters without a glyph show as `?`, if there is one.
+  int fallback = index.count('?') ? index['?'] : 0xff;
+  for (int c = first_char; c <= last_char; c++) {
+    out << ((c - first_char) % 16 == 0 ? "\n    " : " ")
+        << (index.count(static_cast<char>(c)) ? index[static_cast<char>(c)] : fallback) << ",";
+  }
+  out << "\n  },\n  {  // widths";
+  for (size_t i = 0; i < chars.size(); i++) {
+    out << (i % 16 == 0 ? "\n    " : " ") << font.glyphs.at(chars[i]).width << ",";
+  }
+  out << "\n  },\n  {\n";
+  for (char c : chars) {
+    out << "    {";
+    const Glyph &glyph = font.glyphs.at(c);
+    for (size_t y = 0; y < glyph.rows.size(); y++) {
+      char hex[8];
+      snprintf(hex, sizeof(hex), "0x%02x", glyph.rows[y]);
+      out << (y ? ", " : "") << hex;
+    }
+    out << "},  // " << char_literal(c) << "\n";
+  }
+  out << "  },\n  {";
+  if (!kerns.empty()) {
+    out << "  // kerning pairs";
+  }
+  for (const Kern &kern : kerns) {
+    out << "\n    {" << char_literal(kern.left) << ", " << char_literal(kern.right) << ", "
+        << kern.adjust << "},";
+  }
+  out << (kerns.empty() ? "}" : "\n  }") << "\n};\n\n#endif  // " << guard << "\n";
+
+  std::ofstream file(path);
+  file << out.str();
+  if (!file) {
+    line_number = 0;
+    return fail("cannot write header", path);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4 || argc > 5) {
+    fprintf(stderr, "usage: %s <source> <header> <name> [<glyphs>]\n", argv[0]);
+    return 2;
+  }
+  source_name = argv[1];
+  std::vector<std::string> lines;
+  if (!read_lines(source_name, &lines)) {
+    return 1;
+  }
+  Font font;
+  size_t length = source_name.size();
+  bool bdf = length > 4 && source_name.compare(length - 4, 4, ".bdf") == 0;
+  if (!(bdf ? parse_bdf(lines, &font) : parse_art(lines, &font))) {
+    return 1;
+  }
+
+  line_number = 0;
+  if (argc == 5) {
+    std::map<char, Glyph> selected;
+    for (const char *c = argv[4]; *c; c++) {
+      if (!font.glyphs.count(*c)) {
+        fail("no glyph for a selected character", std::string(1, *c));
+        return 1;
+      }
+      selected[*c] = font.glyphs[*c];
+    }
+    font.glyphs = selected;
+  }
+  if (font.glyphs.empty()) {
+    fail("font has no glyphs");
+    return 1;
+  }
+  return write_header(font, argv[2], argv[3]) ? 0 : 1;
+}
@@ -0,0 +1,460 @@
+// Build-time time zone compiler: turns the rules in force today of the
+// selected zones of IANA tzdata into a header with a constexpr
+// TimeZoneTable (see time_zone.hpp).
+//
+//   tz_compiler <tzdata> <header> <name> <zone>...
+//
+// <tzdata> is zic input, such as tzdata.zi or the tz source files europe,
+// northamerica and so on, concatenated; keywords, months and weekdays may
+// be abbreviated to any unambiguous prefix, as zic allows. <name> becomes
+// the name of the table, and the zones, which may be links, its entries in
+// the order given.
+//
+// Of each zone only the last line is compiled, the one without UNTIL, and
+// of its rules only those running to "max". A zone must have two of them,
+// one for each change of offset in a year, or none, and no other rules
+// still to come, as zones whose changes follow the lunar calendar have.
+//
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+namespace {
+
+constexpr size_t max_abbreviation = 7;
+
+struct Rule {
+  int from_year = 0;
+  int to_year = 0;                //!< INT32_MAX for "max"
+  int month = 0;                  //!< 1 to 12
+  int day = 0;
+  int weekday = 0;
+  const char *day_rule = "fixed";
+  int at = 0;                     //!< seconds
+  const char *at_base = "wall";
+  int save = 0;                   //!< seconds
+  std::string letter;
+  int line = 0;
+};
+
+struct ZoneLine {
+  int standard_offset = 0;
+  std::string rules;              //!< name of the rules, empty for none
+  int save = 0;                   //!< seconds, if the rules are a fixed amount
+  std::string format;
+  int line = 0;
+};
+
+struct Data {
+  std::map<std::string, std::vector<Rule>> rules;
+  std::map<std::string, ZoneLine> zones;  //!< last line of each zone
+  std::map<std::string, std::string> links;
+};
+
+std::string source_name;
+int line_number = 0;
+
+bool fail(const char *message, const std::string &detail = "") {
+  std::string where = source_name;
+  if (line_number > 0) {
+    where += ":" + std::to_string(line_number);
+  }
+  fprintf(stderr, "%s: %s%s%s\n", where.c_str(), message, detail.empty() ? "" : ": ",
+          detail.c_str());
+  return false;
+}
+
+// Index of the word in `words` that `word` is a prefix of, ignoring case,
+// or -1 if none or more than one is.
+int match(const std::string &word, const std::vector<const char *> &words) {
+  int found = -1;
+  for (size_t i = 0; i < words.size(); i++) {
+    if (word.empty() || word.size() > strlen(words[i])) {
+      continue;
+    }
+    if (strncasecmp(word.c_str(), words[i], word.size()) == 0) {
+      if (word.size() == strlen(words[i])) {
+        return static_cast<int>(i);
+      }
+      if (found >= 0) {
+        return -1;
+      }
+      found = static_cast<int>(i);
+    }
+  }
+  return found;
+}
+
+const std::vector<const char *> months = {
+  "January", "February", "March", "April", "May", "June",
+  "July", "August", "September", "October", "November", "December"
+};
+const std::vector<const char *> weekdays = {
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+bool parse_int(const std::string &text, int *value) {
+  char *end;
+  long number = strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0') {
+    return false;
+  }
+  *value = static_cast<int>(number);
+  return true;
+}
+
+// [-]h[:mm[:ss]] with an optional suffix letter, which goes to `suffix`.
+bool parse_time(std::string text, int *seconds, char *suffix = nullptr) {
+  if (suffix) {
+    *suffix = 'w';
+  }
+  if (text == "-") {
+    *seconds = 0;
+    return true;
+  }
+  if (!text.empty() && isalpha(static_cast<unsigned char>(text.back()))) {
+    if (suffix) {
+      *suffix = static_cast<char>(tolower(static_cast<unsigned char>(text.back())));
+    }
+    text.pop_back();
+  }
+  bool negative = !text.empty() && text[0] == '-';
+  std::istringstream in(text.substr(negative ? 1 : 0));
+  int total = 0;
+  std::string part;
+  int parts = 0;
+  while (std::getline(in, part, ':')) {
+    int value;
+    if (++parts > 3 || !parse_int(part, &value) || value < 0) {
+      return false;
+    }
+    total = total * 60 + value;
+  }
+  if (parts == 0) {
+    return false;
+  }
+  for (; parts < 3; parts++) {
+    total *= 60;
+  }
+  *seconds = negative ? -total : total;
+  return true;
+}
+
+bool parse_year(const std::string &text, int *year, int previous) {
+  switch (match(text, {"minimum", "maximum", "only"})) {
+    case 0:
+      *year = INT32_MIN;
+      return true;
+    case 1:
+      *year = INT32_MAX;
+      return true;
+    case 2:
+      *year = previous;
+      return previous != 0;
+  }
+  return parse_int(text, year);
+}
+
+// The ON field: "5", "lastSun", "Sun>=8" or "Sun<=25"
+bool parse_day(const std::string &text, Rule *rule) {
+  size_t relation = text.find_first_of("<>");
+  if (strncasecmp(text.c_str(), "last", 4) == 0) {
+    rule->day_rule = "last";
+    rule->weekday = match(text.substr(4), weekdays);
+    return rule->weekday >= 0;
+  }
+  if (relation != std::string::npos) {
+    if (relation + 1 >= text.size() || text[relation + 1] != '=') {
+      return false;
+    }
+    rule->day_rule = text[relation] == '>' ? "on_or_after" : "on_or_before";
+    rule->weekday = match(text.substr(0, relation), weekdays);
+    return rule->weekday >= 0 && parse_int(text.substr(relation + 2), &rule->day) &&
+           rule->day >= 1 && rule->day <= 31;
+  }
+  rule->day_rule = "fixed";
+  return parse_int(text, &rule->day) && rule->day >= 1 && rule->day <= 31;
+}
+
+bool parse_rule(const std::vector<std::string> &fields, Data *data) {
+  if (fields.size() != 10) {
+    return fail("a rule has 9 fields");
+  }
+  Rule rule;
+  rule.line = line_number;
+  if (!parse_year(fields[2], &rule.from_year, 0) ||
+      !parse_year(fields[3], &rule.to_year, rule.from_year)) {
+    return fail("bad year", fields[2] + " " + fields[3]);
+  }
+  rule.month = match(fields[5], months) + 1;
+  if (rule.month == 0) {
+    return fail("bad month", fields[5]);
+  }
+  if (!parse_day(fields[6], &rule)) {
+    return fail("bad day", fields[6]);
+  }
+  char suffix;
+  if (!parse_time(fields[7], &rule.at, &suffix)) {
+    return fail("bad time of day", fields[7]);
+  }
+  switch (suffix) {
+    case 'w':
+      rule.at_base = "wall";
+      break;
+    case 's':
+      rule.at_base = "standard";
+      break;
+    case 'u':
+    case 'g':
+    case 'z':
+      rule.at_base = "universal";
+      break;
+    default:
+      return fail("bad time of day", fields[7]);
+  }
+  if (!parse_time(fields[8], &rule.save)) {
+    return fail("bad saved time", fields[8]);
+  }
+  rule.letter = fields[9] == "-" ? "" : fields[9];
+  data->rules[fields[1]].push_back(rule);
+  return true;
+}
+
+// STDOFF RULES FORMAT [UNTIL], from `first` on
+bool parse_zone_line(const std::vector<std::string> &fields, size_t first, ZoneLine *zone,
+                     bool *until) {
+  if (fields.size() < first + 3) {
+    return fail("a zone line has at least 3 fields");
+  }
+  zone->line = line_number;
+  if (!parse_time(fields[first], &zone->standard_offset)) {
+    return fail("bad offset", fields[first]);
+  }
+  const std::string &rules = fields[first + 1];
+  zone->rules.clear();
+  zone->save = 0;
+  if (rules != "-" && (isdigit(static_cast<unsigned char>(rules[0])) || rules[0] == '-')) {
+    if (!parse_time(rules, &zone->save)) {
+      return fail("bad saved time", rules);
+    }
+  } else if (rules != "-") {
+    zone->rules = rules;
+  }
+  zone->format = fields[first + 2];
+  *until = fields.size() > first + 3;
+  return true;
+}
+
+bool parse(const std::string &path, Data *data) {
+  std::ifstream in(path);
+  if (!in) {
+    return fail("cannot open tzdata");
+  }
+  std::string line;
+  std::string zone_name;  // zone that continuation lines belong to
+  bool continued = false;
+  while (std::getline(in, line)) {
+    line_number++;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    std::istringstream words(line);
+    std::vector<std::string> fields;
+    std::string word;
+    while (words >> word) {
+      fields.push_back(word);
+    }
+    if (fields.empty()) {
+      continue;
+    }
+    if (continued) {
+      if (!parse_zone_line(fields, 0, &data->zones[zone_name], &continued)) {
+        return false;
+      }
+      continue;
+    }
+    switch (match(fields[0], {"Rule", "Zone", "Link"})) {
+      case 0:
+        if (!parse_rule(fields, data)) {
+          return false;
+        }
+        break;
+      case 1:
+        if (fields.size() < 2) {
+          return fail("zone without a name");
+        }
+        zone_name = fields[1];
+        if (!parse_zone_line(fields, 2, &data->zones[zone_name], &continued)) {
+          return false;
+        }
+        break;
+      case 2:
+        if (fields.size() != 3) {
+          return fail("a link has 2 fields");
+        }
+        data->links[fields[2]] = fields[1];
+        break;
+      default:
+        return fail("unknown line", fields[0]);
+    }
+  }
+  if (continued) {
+    return fail("zone ends with UNTIL", zone_name);
+  }
+  return true;
+}
+
+// FORMAT with the rule's letters, or the standard or daylight saving half
+// of "std/dst", or the offset for "%z".
+std::string abbreviation(const std::string &format, const std::string &letter, int save,
+                         int offset) {
+  size_t slash = format.find('/');
+  if (slash != std::string::npos) {
+    return save == 0 ? format.substr(0, slash) : format.substr(slash + 1);
+  }
+  size_t percent = format.find('%');
+  if (percent == std::string::npos || percent + 1 == format.size()) {
+    return format;
+  }
+  std::string replacement;
+  if (format[percent + 1] == 's') {
+    replacement = letter;
+  } else if (format[percent + 1] == 'z') {
+    int magnitude = offset < 0 ? -offset : offset;
+    char text[16];
+    snprintf(text, sizeof(text), "%c%02d", offset < 0 ? '-' : '+', magnitude / 3600);
+    replacement = text;
+    if (magnitude % 3600 != 0) {
+      snprintf(text, sizeof(text), "%02d", magnitude / 60 % 60);
+      replacement += text;
+    }
+    if (magnitude % 60 != 0) {
+      snprintf(text, sizeof(text), "%02d", magnitude % 60);
+      replacement += text;
+    }
+  }
+  return format.substr(0, percent) + replacement + format.substr(percent + 2);
+}
+
+std::string quoted(const std::string &text) { return "\"" + text + "\""; }
+
+bool write_zone(std::ostream &out, const Data &data, const std::string &name, int this_year) {
+  std::string target = name;
+  for (int hops = 0; data.links.count(target); hops++) {
+    if (hops > 8) {
+      return fail("link loop", name);
+    }
+    target = data.links.at(target);
+  }
+  if (!data.zones.count(target)) {
+    return fail("no such zone", name);
+  }
+  const ZoneLine &zone = data.zones.at(target);
+  line_number = zone.line;
+  std::vector<const Rule *> ongoing;
+  const Rule *latest = nullptr;
+  if (!zone.rules.empty()) {
+    if (!data.rules.count(zone.rules)) {
+      return fail("no such rules", zone.rules);
+    }
+    for (const Rule &rule : data.rules.at(zone.rules)) {
+      if (rule.to_year == INT32_MAX) {
+        ongoing.push_back(&rule);
+      } else if (rule.to_year >= this_year) {
+        line_number = rule.line;
+        return fail("zone changes by rules for single years, which a table cannot hold", name);
+      }
+      if (!latest || rule.to_year > latest->to_year ||
+          (rule.to_year == latest->to_year && rule.month > latest->month)) {
+        latest = &rule;
+      }
+    }
+  }
+  if (ongoing.size() != 0 && ongoing.size() != 2) {
+    return fail("zone needs 0 or 2 ongoing rules", name);
+  }
+
+  int save = ongoing.empty() && latest ? latest->save : zone.save;
+  int offset = zone.standard_offset + save;
+  std::string fixed = abbreviation(zone.format, latest && ongoing.empty() ? latest->letter : "",
+                                   save, offset);
+  out << "  {" << quoted(name) << ", " << zone.standard_offset << ", " << offset << ", "
+      << quoted(ongoing.empty() ? fixed : "") << ", " << ongoing.size() << ", {";
+  for (const Rule *rule : ongoing) {
+    int rule_offset = zone.standard_offset + rule->save;
+    std::string text = abbreviation(zone.format, rule->letter, rule->save, rule_offset);
+    if (text.size() > max_abbreviation) {
+      line_number = rule->line;
+      return fail("abbreviation too long", text);
+    }
+    out << "\n    {" << rule->month << ", " << rule->day << ", " << rule->weekday
+        << ", DayRule::" << rule->day_rule << ", " << rule->at << ", TimeBase::" << rule->at_base
+        << ", " << rule_offset << ", " << quoted(text) << "},";
+  }
+  if (fixed.size() > max_abbreviation) {
+    return fail("abbreviation too long", fixed);
+  }
+  out << (ongoing.empty() ? "}},\n" : "\n  }},\n");
+  return true;
+}
+
+bool write_header(const Data &data, const std::string &path, const std::string &name,
+                  const std::vector<std::string> &zones) {
+  std::string guard;
+  for (char c : name) {
+    guard += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
+  guard += "_HPP";
+
+  time_t now = time(nullptr);
+  int this_year = gmtime(&now)->tm_year + 1900;
+
+  std::ostringstream out;
+  out << "// Generated by tz_compiler from " << source_name << "; do not edit.\n\n"
+      << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+      << "#include \"time_zone.hpp\"\n\n"
+      << "constexpr TimeZoneTable<" << zones.size() << "> " << name << " = {{\n";
+  for (const std::string &zone : zones) {
+    if (!write_zone(out, data, zone, this_year)) {
+      return false;
+    }
+  }
+  out << "}};\n\n#endif  // " << guard << "\n";
+
+  std::ofstream file(path);
+  file << out.str();
+  if (!file) {
+    line_number = 0;
+    return fail("cannot write header", path);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 5) {
+    fprintf(stderr, "usage: %s <tzdata> <header> <name> <zone>...\n", argv[0]);
+    return 2;
+  }
+  source_name = argv[1];
+  Data data;
+  if (!parse(source_name, &data)) {
+    return 1;
+  }
+  std::vector<std::string> zones(argv + 4, argv + argc);
+  return write_header(data, argv[2], argv[3], zones) ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef TRANSITION_HPP
+#define TRANSITION_HPP
+
+#include <cstdint>
+
+#include "gamma.hpp"
+#include "glyph.hpp"
+
+// Transitions of a glyph cell from one glyph to the next over a fixed
+// number of frames, for the digit flips of the clock.
+//
+// The easing curves are tabulated at compile time as fixed-point progress
+// per frame, in 1/256 of the whole way, and everything a transition needs
+// beyond that (dither masks, gamma-corrected fade levels, row scaling for
+// the flap) is tabulated as well. Drawing a frame therefore takes no
+// floats and no divisions, and every transition composes each of the
+// cell's rows once and blits them, so a frame costs the same whichever
+// transition and curve a cell runs.
+enum class Transition : uint8_t {
+  roll,        //!< the old glyph rolls up and out, the new one follows from below
+  slide,       //!< the old glyph slides out to the left, the new one in from the right
+  fade,        //!< ordered-dither cross-fade from the old glyph into the new one
+  split_flap,  //!< the top half folds down over the hinge like a split-flap display
+};
+
+enum class Easing : uint8_t {
+  linear,
+  ease_in,      //!< quadratic, starts slowly
+  ease_out,     //!< quadratic, ends slowly
+  ease_in_out,  //!< cubic, starts and ends slowly
+};
+
+struct TransitionStyle {
+  Transition transition;
+  Easing     easing;
+};
+
+constexpr int num_easings = 4;
+constexpr int transition_one = 256;  //!< progress of a finished transition
+
+// Everything a CellTransition looks up per frame
+template <int TopRows, int BottomRows, int Frames>
+struct TransitionTables {
+  uint16_t progress[num_easings][Frames + 1];          //!< eased progress of each frame, 0 to one
+  uint8_t  fade_in[num_easings][Frames + 1];           //!< pixels of 16 the new glyph shows
+  uint8_t  fade_out[num_easings][Frames + 1];          //!< pixels of 16 the old glyph still shows
+  uint8_t  dither[17][4];                              //!< 4x4 Bayer masks of 0 to 16 set pixels
+  uint8_t  top_scale[TopRows + 1][TopRows];            //!< source row of each row of a squashed top half
+  uint8_t  bottom_scale[BottomRows + 1][BottomRows];   //!< same for the bottom half
+};
+
+constexpr double ease(Easing easing, double t) {
+  switch (easing) {
+    case Easing::linear:
+      return t;
+    case Easing::ease_in:
+      return t * t;
+    case Easing::ease_out:
+      return 1 - (1 - t) * (1 - t);
+    case Easing::ease_in_out:
+      return t < 0.5 ? 4 * t * t * t : 1 - 4 * (1 - t) * (1 - t) * (1 - t);
+  }
+  return t;
+}
+
+template <int TopRows, int BottomRows, int Frames>
+constexpr TransitionTables<TopRows, BottomRows, Frames> make_transition_tables() {
+  TransitionTables<TopRows, BottomRows, Frames> tables{};
+  for (int easing = 0; easing < num_easings; easing++) {
+    for (int frame = 0; frame <= Frames; frame++) {
+      double t = static_cast<double>(frame) / Frames;
+      double eased = ease(static_cast<Easing>(easing), t);
+      tables.progress[easing][frame] = static_cast<uint16_t>(eased * transition_one + 0.5);
+      // A glyph showing a fraction f of its pixels emits f of its light and
+      // looks f^(1/gamma) as bright, so the glyphs' pixel counts follow the
+      // gamma curve for their brightness to follow the easing.
+      tables.fade_in[easing][frame] =
+        static_cast<uint8_t>(16 * gamma_pow(eased, display_gamma) + 0.5);
+      tables.fade_out[easing][frame] =
+        static_cast<uint8_t>(16 * gamma_pow(1 - eased, display_gamma) + 0.5);
+    }
+  }
+  constexpr uint8_t bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+  for (int level = 0; level <= 16; level++) {
+    for (int row = 0; row < 4; row++) {
+      for (int column = 0; column < 8; column++) {
+        if (bayer[row][column % 4] < level) {
+          tables.dither[level][row] |= static_cast<uint8_t>(1u << column);
+        }
+      }
+    }
+  }
+  for (int n = 1; n <= TopRows; n++) {
+    for (int i = 0; i < n; i++) {
+      tables.top_scale[n][i] = static_cast<uint8_t>(i * TopRows / n);
+    }
+  }
+  for (int n = 1; n <= BottomRows; n++) {
+    for (int i = 0; i < n; i++) {
+      tables.bottom_scale[n][i] = static_cast<uint8_t>(i * BottomRows / n);
+    }
+  }
+  return tables;
+}
+
+template <int Width, int Height, int Frames>
+class CellTransition {
+  static_assert(Width >= 1 && Width <= 8, "glyph rows are packed into one byte");
+  static_assert(Height >= 2, "the split flap needs two halves");
+  static_assert(Frames >= 1, "transitions take at least one frame");
+
+public:
+  static constexpr int frames = Frames;
+
+  // Draws the cell at (x, y) with the current pen, `frame` frames into the
+  // transition from the glyph rows `from` to `to`; frame 0 shows `from`
+  // and frame Frames shows `to`. Only lit pixels are set, the caller
+  // clears the cell first.
+  static void draw(pimoroni::PicoGraphics &graphics, int x, int y, TransitionStyle style,
+                   int frame, const uint8_t *from, const uint8_t *to) {
+    uint8_t rows[Height];
+    int progress = tables.progress[static_cast<int>(style.easing)][frame];
+    switch (style.transition) {
+      case Transition::roll:
+        roll(rows, progress, from, to);
+        break;
+      case Transition::slide:
+        slide(rows, progress, from, to);
+        break;
+      case Transition::fade:
+        fade(rows, tables.fade_in[static_cast<int>(style.easing)][frame],
+             tables.fade_out[static_cast<int>(style.easing)][frame], from, to);
+        break;
+      case Transition::split_flap:
+        split_flap(rows, progress, from, to);
+        break;
+    }
+    blit_rows(graphics, x, y, rows, Height);
+  }
+
+private:
+  static constexpr int one = transition_one;
+  static constexpr int top_rows = Height / 2;            //!< rows above the flap's hinge
+  static constexpr int bottom_rows = Height - top_rows;  //!< rows below it
+  static constexpr uint8_t width_mask = static_cast<uint8_t>((1u << Width) - 1);
+  static constexpr TransitionTables<top_rows, bottom_rows, Frames> tables =
+    make_transition_tables<top_rows, bottom_rows, Frames>();
+
+  static_assert(tables.progress[0][0] == 0 && tables.progress[0][Frames] == one,
+                "transitions run from the old glyph to the new one");
+
+  // `progress` of `total`, rounded
+  static int scale(int progress, int total) { return (progress * total + one / 2) >> 8; }
+
+  static void roll(uint8_t *rows, int progress, const uint8_t *from, const uint8_t *to) {
+    int rolled = scale(progress, Height);
+    for (int i = 0; i < Height; i++) {
+      rows[i] = i < Height - rolled ? from[i + rolled] : to[i - (Height - rolled)];
+    }
+  }
+
+  static void slide(uint8_t *rows, int progress, const uint8_t *from, const uint8_t *to) {
+    int slid = scale(progress, Width);
+    for (int i = 0; i < Height; i++) {
+      // Bit x is column x, so shifting right moves pixels to the left.
+      rows[i] = static_cast<uint8_t>(((from[i] >> slid) | (to[i] << (Width - slid))) &
+                                     width_mask);
+    }
+  }
+
+  // The new glyph lights the pixels of the lowest `in` dither thresholds,
+  // the old one those of the highest `out`, so the two only share pixels
+  // lit in both glyphs.
+  static void fade(uint8_t *rows, int in, int out, const uint8_t *from, const uint8_t *to) {
+    const uint8_t *in_masks = tables.dither[in];
+    const uint8_t *out_masks = tables.dither[16 - out];
+    for (int i = 0; i < Height; i++) {
+      rows[i] = static_cast<uint8_t>((from[i] & ~out_masks[i & 3]) | (to[i] & in_masks[i & 3]));
+    }
+  }
+
+  // The new glyph's top half is already there behind the flap, and the old
+  // glyph's bottom half until the flap has fallen past the hinge. The flap
+  // first shows the old top half squashed towards the hinge, then the new
+  // bottom half unfolding from it.
+  static void split_flap(uint8_t *rows, int progress, const uint8_t *from, const uint8_t *to) {
+    for (int i = 0; i < Height; i++) {
+      rows[i] = i < top_rows ? to[i] : from[i];
+    }
+    if (progress < one / 2) {
+      int flap = top_rows - scale(2 * progress, top_rows);
+      const uint8_t *source = tables.top_scale[flap];
+      for (int i = 0; i < flap; i++) {
+        rows[top_rows - flap + i] = from[source[i]];
+      }
+    } else {
+      int flap = scale(2 * progress - one, bottom_rows);
+      const uint8_t *source = tables.bottom_scale[flap];
+      for (int i = 0; i < flap; i++) {
+        rows[top_rows + i] = to[top_rows + source[i]];
+      }
+    }
+  }
+};
+
+#endif  // TRANSITION_HPP
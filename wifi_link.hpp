@@ -0,0 +1,123 @@
+// (c) 2023 Rene Mueller, Zofingen, Switzerland
+
+#ifndef WIFI_LINK_HPP
+#define WIFI_LINK_HPP
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "pico/cyw43_arch.h"
+#include "pico/stdlib.h"
+
+// Keeps the station associated with the access point without blocking the
+// main loop. A join is started with cyw43_arch_wifi_connect_async() and
+// followed by polling the link status; a join that fails or takes too long
+// is retried after a backoff that doubles up to a few minutes, and a link
+// that drops later is joined again right away.
+//
+// The main loop calls poll() once next_poll() is reached. Counters and
+// the time each connect took are kept for the log.
+class WifiLink {
+public:
+  static constexpr uint32_t join_poll_ms = 100;       //!< link status polls while joining
+  static constexpr uint32_t watch_poll_ms = 1000;     //!< link status polls while up
+  static constexpr uint32_t join_timeout_ms = 20000;  //!< gives up on a join after this
+  static constexpr uint32_t first_backoff_ms = 2000;
+  static constexpr uint32_t max_backoff_ms = 5 * 60 * 1000;
+
+  // Starts the first join; `ssid` and `password` must outlive the link.
+  void start(const char *ssid, const char *password, uint32_t auth) {
+    this->ssid = ssid;
+    this->password = password;
+    this->auth = auth;
+    down_since = get_absolute_time();
+    join();
+  }
+
+  bool up() const { return state == State::up; }
+
+  absolute_time_t next_poll() const { return poll_time; }
+
+  // Moves the connection on; returns true if the link came up or went down.
+  bool poll() {
+    int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    switch (state) {
+      case State::joining:
+        if (status == CYW43_LINK_UP) {
+          state = State::up;
+          backoff_ms = first_backoff_ms;
+          last_connect_ms = static_cast<uint32_t>(
+            absolute_time_diff_us(down_since, get_absolute_time()) / 1000);
+          if (last_connect_ms > max_connect_ms) {
+            max_connect_ms = last_connect_ms;
+          }
+          printf("wifi: connected after %" PRIu32 " ms, %" PRIu32 " joins, %" PRIu32
+                 " reconnects, slowest %" PRIu32 " ms\n", last_connect_ms, joins, reconnects,
+                 max_connect_ms);
+          poll_time = make_timeout_time_ms(watch_poll_ms);
+          return true;
+        }
+        if (status < 0 || time_reached(join_deadline)) {
+          failed_joins++;
+          printf("wifi: join failed (status %d), retrying in %" PRIu32 " ms\n", status,
+                 backoff_ms);
+          state = State::backoff;
+          poll_time = make_timeout_time_ms(backoff_ms);
+          backoff_ms = backoff_ms >= max_backoff_ms / 2 ? max_backoff_ms : 2 * backoff_ms;
+          return false;
+        }
+        poll_time = make_timeout_time_ms(join_poll_ms);
+        return false;
+      case State::up:
+        if (status == CYW43_LINK_UP) {
+          poll_time = make_timeout_time_ms(watch_poll_ms);
+          return false;
+        }
+        reconnects++;
+        printf("wifi: link lost (status %d), reconnecting\n", status);
+        down_since = get_absolute_time();
+        join();
+        return true;
+      case State::backoff:
+        join();
+        return false;
+    }
+    return false;
+  }
+
+  uint32_t join_count() const { return joins; }
+  uint32_t failed_join_count() const { return failed_joins; }
+  uint32_t reconnect_count() const { return reconnects; }
+  uint32_t last_connect_time_ms() const { return last_connect_ms; }  //!< from link loss or start
+  uint32_t max_connect_time_ms() const { return max_connect_ms; }
+
+private:
+  enum class State : uint8_t { joining, up, backoff };
+
+  void join() {
+    joins++;
+    state = State::joining;
+    join_deadline = make_timeout_time_ms(join_timeout_ms);
+    poll_time = make_timeout_time_ms(join_poll_ms);
+    if (cyw43_arch_wifi_connect_async(ssid, password, auth) != 0) {
+      // Counts as a failed join at the next poll.
+      join_deadline = get_absolute_time();
+    }
+  }
+
+  const char     *ssid = nullptr;
+  const char     *password = nullptr;
+  uint32_t        auth = 0;
+  State           state = State::backoff;
+  absolute_time_t poll_time = at_the_end_of_time;
+  absolute_time_t join_deadline = at_the_end_of_time;
+  absolute_time_t down_since = nil_time;  //!< power-on or when the link was lost
+  uint32_t        backoff_ms = first_backoff_ms;
+  uint32_t        joins = 0;
+  uint32_t        failed_joins = 0;
+  uint32_t        reconnects = 0;
+  uint32_t        last_connect_ms = 0;
+  uint32_t        max_connect_ms = 0;
+};
+
+#endif  // WIFI_LINK_HPP